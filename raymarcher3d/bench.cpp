@@ -0,0 +1,516 @@
+#include "bench.hpp"
+#include "scenestore.hpp"
+#include "scenetemplates.hpp"
+#include "simd.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <math.h>
+#include <random>
+
+using namespace std;
+
+bool parseBenchArgs(int argc, char* argv[], BenchOptions& opt)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--bench") == 0 && hasValue)
+		{
+			opt.enabled = true;
+			opt.suite = argv[++i];
+		}
+		else if (strcmp(argv[i], "--bench-shapes") == 0 && hasValue) opt.shapes = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bench-points") == 0 && hasValue) opt.points = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bench-seed") == 0 && hasValue) opt.seed = (unsigned)atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bench-voxel") == 0 && hasValue) opt.voxel = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--bench-k") == 0 && hasValue) opt.k = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--bench-format") == 0 && hasValue) opt.format = argv[++i];
+	}
+
+	if (opt.shapes < 1) opt.shapes = 1;
+	if (opt.points < 1) opt.points = 1;
+
+	return opt.enabled;
+}
+
+void randomScene(int count, unsigned seed, vector<Shape*>& out)
+{
+	mt19937 rng(seed);
+	uniform_real_distribution<float> pos(-8.0f, 8.0f);
+	uniform_real_distribution<float> size(0.1f, 1.5f);
+
+	for (int i = 0; i < count; i++)
+	{
+		Vector3 origin = { pos(rng), pos(rng), pos(rng) };
+		Shape* s;
+
+		switch (i % 3)
+		{
+			case 0: s = new Sphere(origin, size(rng)); break;
+			case 1: s = new Box(origin, { size(rng), size(rng), size(rng) }); break;
+			default: s = new Torus(origin, { size(rng) + 0.5f, size(rng) * 0.4f }); break;
+		}
+		out.push_back(s);
+	}
+}
+
+void randomPoints(int count, unsigned seed, vector<Vector3>& out)
+{
+	mt19937 rng(seed);
+	uniform_real_distribution<float> pos(-10.0f, 10.0f);
+
+	out.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		out[i] = { pos(rng), pos(rng), pos(rng) };
+	}
+}
+
+// ns per call of fn(i) over count iterations, repeated until ~0.2s has passed
+template <typename F>
+static double timeNs(int count, F fn)
+{
+	long long calls = 0;
+	double elapsed = 0.0;
+	auto start = chrono::steady_clock::now();
+
+	while (elapsed < 0.2)
+	{
+		for (int i = 0; i < count; i++) fn(i);
+		calls += count;
+		elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+	return elapsed * 1e9 / calls;
+}
+
+static volatile float sink;
+
+void benchStore(const BenchOptions& opt)
+{
+	vector<Shape*> shapes;
+	vector<Vector3> pts;
+	randomScene(opt.shapes, opt.seed, shapes);
+	randomPoints(opt.points, opt.seed + 1, pts);
+
+	SceneStore store;
+	store.build(shapes.data(), (int)shapes.size());
+
+	// results should agree wherever the virtual chain hasn't underflowed
+	float maxErr = 0.0f;
+	for (int i = 0; i < opt.points; i++)
+	{
+		float a = SdfMinOfAll(shapes.data(), pts[i], (int)shapes.size(), k);
+		float b = store.sdf(pts[i], k);
+		if (isfinite(a)) maxErr = max(maxErr, fabsf(a - b));
+	}
+
+	double virt = timeNs(opt.points, [&](int i) { sink = SdfMinOfAll(shapes.data(), pts[i], (int)shapes.size(), k); });
+	double flat = timeNs(opt.points, [&](int i) { sink = store.sdf(pts[i], k); });
+
+	printf("store: %d shapes, k=%.2f\n", opt.shapes, k);
+	printf("  %-24s %10.1f ns/op\n", "SdfMinOfAll (virtual)", virt);
+	printf("  %-24s %10.1f ns/op  (x%.2f, max err %g)\n", "SceneStore::sdf", flat, virt / flat, maxErr);
+
+	freeShapes(shapes);
+}
+
+// the same fixed six-shape scene as runtime shapes and as a template expression
+void benchTemplates(const BenchOptions& opt)
+{
+	using namespace sdfx;
+
+	const Vector3 o[6] = { { 2.0f, -3.5f, 1.0f }, { 0.0f, 0.0f, 0.0f }, { -2.0f, 2.0f, 2.0f },
+		{ 3.0f, 1.0f, -2.0f }, { -3.0f, -1.0f, -1.0f }, { 0.0f, 2.5f, -3.0f } };
+
+	Shape* shapes[6] = {
+		new Box(o[0], { 1.5f, 1.5f, 1.5f }),
+		new Sphere(o[1], 1.0f),
+		new Torus(o[2], { 1.0f, 0.3f }),
+		new Sphere(o[3], 0.7f),
+		new Box(o[4], { 0.5f, 1.0f, 0.5f }),
+		new Torus(o[5], { 1.5f, 0.2f })
+	};
+
+	const float kk = k;
+	auto scene =
+		smoothUnion(smoothUnion(smoothUnion(smoothUnion(smoothUnion(
+			BoxX(o[0], { 1.5f, 1.5f, 1.5f }),
+			SphereX(o[1], 1.0f), kk),
+			TorusX(o[2], { 1.0f, 0.3f }), kk),
+			SphereX(o[3], 0.7f), kk),
+			BoxX(o[4], { 0.5f, 1.0f, 0.5f }), kk),
+			TorusX(o[5], { 1.5f, 0.2f }), kk);
+
+	vector<Vector3> pts;
+	randomPoints(opt.points, opt.seed + 1, pts);
+
+	float maxErr = 0.0f;
+	for (int i = 0; i < opt.points; i++)
+	{
+		float a = SdfMinOfAll(shapes, pts[i], 6, k);
+		if (isfinite(a)) maxErr = max(maxErr, fabsf(a - scene(pts[i])));
+	}
+
+	double virt = timeNs(opt.points, [&](int i) { sink = SdfMinOfAll(shapes, pts[i], 6, k); });
+	double expr = timeNs(opt.points, [&](int i) { sink = scene(pts[i]); });
+
+	// whole rays through a 200x150 view of the scene
+	Cam3d cam;
+	cam.origin = { 0.0f, 0.0f, 8.0f };
+	cam.initRays(200, 150);
+	int rayCount = cam.rays.count;
+
+	double virtRay = timeNs(rayCount, [&](int i) {
+		if (i == 0) cam.initRays(200, 150);
+		cam.marchRay(i, shapes, 6);
+	});
+	double exprRay = timeNs(rayCount, [&](int i) {
+		if (i == 0) cam.initRays(200, 150);
+		cam.marchRayWith(i, scene);
+	});
+
+	printf("templates: 6 shapes, k=%.2f\n", k);
+	printf("  %-24s %10.1f ns/op\n", "SdfMinOfAll (virtual)", virt);
+	printf("  %-24s %10.1f ns/op  (x%.2f, max err %g)\n", "expression template", expr, virt / expr, maxErr);
+	printf("  %-24s %10.1f ns/ray\n", "marchRay (virtual)", virtRay);
+	printf("  %-24s %10.1f ns/ray  (x%.2f)\n", "marchRayWith (template)", exprRay, virtRay / exprRay);
+
+	for (int i = 0; i < 6; i++) delete shapes[i];
+}
+
+void benchBvh(const BenchOptions& opt)
+{
+	vector<Shape*> shapes;
+	vector<Vector3> pts;
+	randomScene(opt.shapes, opt.seed, shapes);
+	randomPoints(opt.points, opt.seed + 1, pts);
+	int count = (int)shapes.size();
+
+	ShapeBVH bvh;
+	auto buildStart = chrono::steady_clock::now();
+	bvh.build(shapes.data(), count);
+	double buildUs = chrono::duration<double, micro>(chrono::steady_clock::now() - buildStart).count();
+
+	// the BVH may only ever under-estimate the full smooth union
+	float maxOver = 0.0f;
+	float maxUnder = 0.0f;
+	long long evaluated = 0;
+	for (int i = 0; i < opt.points; i++)
+	{
+		int n;
+		float a = SdfMinOfAll(shapes.data(), pts[i], count, k);
+		float b = bvh.sdf(pts[i], k, n);
+		evaluated += n;
+		if (isfinite(a))
+		{
+			maxOver = max(maxOver, b - a);
+			maxUnder = max(maxUnder, a - b);
+		}
+	}
+
+	double full = timeNs(opt.points, [&](int i) { sink = SdfMinOfAll(shapes.data(), pts[i], count, k); });
+	double culled = timeNs(opt.points, [&](int i) { sink = bvh.sdf(pts[i], k); });
+
+	// move every shape a little, then refit
+	for (int i = 0; i < count; i++) shapes[i]->origin += Vector3{ 0.01f, -0.02f, 0.01f };
+	double refitUs = timeNs(1, [&](int) { bvh.refit(); }) / 1000.0;
+
+	printf("bvh: %d shapes, k=%.2f, blend margin %.1fk\n", count, k, bvh.blendScale);
+	printf("  %-24s %10.1f ns/op\n", "SdfMinOfAll (all shapes)", full);
+	printf("  %-24s %10.1f ns/op  (x%.2f, %.1f shapes/query, over %g, under %g)\n", "ShapeBVH::sdf", culled, full / culled,
+		(double)evaluated / opt.points, maxOver, maxUnder);
+	printf("  %-24s %10.1f us\n", "build", buildUs);
+	printf("  %-24s %10.1f us\n", "refit", refitUs);
+
+	freeShapes(shapes);
+}
+
+void benchBrickMap(const BenchOptions& opt)
+{
+	vector<Shape*> shapes;
+	vector<Vector3> pts;
+	randomScene(opt.shapes, opt.seed, shapes);
+	randomPoints(opt.points, opt.seed + 1, pts);
+	int count = (int)shapes.size();
+
+	SceneStore store;
+	store.build(shapes.data(), count);
+	auto exact = [&](Vector3 p) { return store.sdf(p, k); };
+
+	for (int bits = 8; bits <= 16; bits += 8)
+	{
+		BrickMap baked;
+		auto start = chrono::steady_clock::now();
+		baked.bake(exact, sceneBounds(shapes.data(), count, k), opt.voxel, bits, opt.voxel * 4.0f);
+		double bakeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		// error inside the band, and how far it over-estimates outside surfaces
+		// (inside them any negative value is a hit, so only the sign matters)
+		float bandErr = 0.0f;
+		float over = 0.0f;
+		for (int i = 0; i < opt.points; i++)
+		{
+			float a = exact(pts[i]);
+			float b = baked.sdf(pts[i]);
+			if (fabsf(a) < baked.band) bandErr = max(bandErr, fabsf(a - b));
+			else if (a > 0.0f) over = max(over, b - a);
+		}
+
+		double ns = timeNs(opt.points, [&](int i) { sink = baked.sdf(pts[i]); });
+
+		printf("brickmap: %d shapes, voxel %.3f, %d-bit, %d bricks, %.1f KiB, bake %.1f ms\n", count, opt.voxel, bits,
+			baked.brickCount, baked.memoryBytes() / 1024.0, bakeMs);
+		printf("  %-24s %10.1f ns/op  (band err %g, max over-estimate %g)\n", "BrickMap::sdf", ns, bandErr, over);
+	}
+
+	double full = timeNs(opt.points, [&](int i) { sink = SdfMinOfAll(shapes.data(), pts[i], count, k); });
+	printf("  %-24s %10.1f ns/op\n", "SdfMinOfAll", full);
+
+	freeShapes(shapes);
+}
+
+// every smooth-union variant, on raw distance pairs and chained over a scene
+void benchSmin(const BenchOptions& opt)
+{
+	vector<Shape*> shapes;
+	vector<Vector3> pts;
+	randomScene(opt.shapes, opt.seed, shapes);
+	randomPoints(opt.points, opt.seed + 1, pts);
+	int count = (int)shapes.size();
+
+	// pairs of distances to two random shapes at each point
+	mt19937 rng(opt.seed + 2);
+	uniform_int_distribution<int> pick(0, count - 1);
+	vector<float> a(opt.points), b(opt.points);
+	for (int i = 0; i < opt.points; i++)
+	{
+		a[i] = shapes[pick(rng)]->sdf(pts[i]);
+		b[i] = shapes[pick(rng)]->sdf(pts[i]);
+	}
+
+	printf("smin: %d shapes, k=%.2f\n", count, k);
+
+	double pairRef = timeNs(opt.points, [&](int i) { sink = smin(a[i], b[i], k); });
+	double sceneRef = timeNs(opt.points, [&](int i) { sink = SdfMinOfAll(shapes.data(), pts[i], count, k); });
+	printf("  %-24s %10.1f ns/pair %10.1f ns/scene\n", "smin() (original)", pairRef, sceneRef);
+
+	SminMode modes[] = { SMIN_EXPONENTIAL, SMIN_POLYNOMIAL, SMIN_CUBIC, SMIN_HARD };
+	for (int m = 0; m < 4; m++)
+	{
+		SminMode mode = modes[m];
+
+		int skipped = 0;
+		float radius = sminRadius(k, mode);
+		for (int i = 0; i < opt.points; i++) skipped += fabsf(a[i] - b[i]) >= radius;
+
+		double pair = timeNs(opt.points, [&](int i) { sink = sminBlend(a[i], b[i], k, mode).x; });
+		double scene = timeNs(opt.points, [&](int i) { sink = SdfMinOfAll(shapes.data(), pts[i], count, k, mode); });
+		double color = timeNs(opt.points, [&](int i) { sink = SdfColorOfAll(shapes.data(), pts[i], count, k, mode).w; });
+
+		char name[64];
+		snprintf(name, sizeof(name), "sminBlend (%s)", sminName(mode));
+		printf("  %-24s %10.1f ns/pair %10.1f ns/scene %10.1f ns/scene+colour  (%.1f%% pairs skip the blend)\n",
+			name, pair, scene, color, 100.0 * skipped / opt.points);
+	}
+
+	freeShapes(shapes);
+}
+
+// power 8 bulb: the shader's trig formulation against the integer power
+// expansion, scalar and packet
+void benchMandelbulb(const BenchOptions& opt)
+{
+	const float iterations = 8.0f, scale = 1.0f, power = 8.0f;
+	Mandelbulb bulb({ 0.0f, 0.0f, 0.0f }, { iterations, scale, power });
+
+	// points in and around the bulb, where the orbits run longest
+	mt19937 rng(opt.seed + 1);
+	uniform_real_distribution<float> pos(-1.5f, 1.5f);
+	vector<float> px(opt.points), py(opt.points), pz(opt.points), out(opt.points);
+	vector<Vector3> pts(opt.points);
+	for (int i = 0; i < opt.points; i++)
+	{
+		pts[i] = { pos(rng), pos(rng), pos(rng) };
+		px[i] = pts[i].x; py[i] = pts[i].y; pz[i] = pts[i].z;
+	}
+
+	vector<float> ref(opt.points);
+	float maxErr = 0.0f;
+	for (int i = 0; i < opt.points; i++)
+	{
+		ref[i] = mandelbulbDE(pts[i], iterations, scale, power, true);
+		float d = bulb.sdf(pts[i]);
+		if (isfinite(ref[i])) maxErr = max(maxErr, fabsf(d - ref[i]));
+	}
+
+	double trig = timeNs(opt.points, [&](int i) { sink = mandelbulbDE(pts[i], iterations, scale, power, true); });
+	double integer = timeNs(opt.points, [&](int i) { sink = bulb.sdf(pts[i]); });
+
+	printf("mandelbulb: power %.0f, %.0f iterations\n", power, iterations);
+	printf("  %-24s %10.1f ns/point\n", "scalar, trig", trig);
+	printf("  %-24s %10.1f ns/point  (x%.2f, max err %g)\n", "scalar, integer power", integer, trig / integer, maxErr);
+
+	Shape* shapes[1] = { &bulb };
+	PacketShape packed;
+	packShapes(shapes, 1, &packed);
+
+	SimdLevel levels[] = { SIMD_SCALAR, SIMD_SSE, SIMD_AVX2, SIMD_AVX512 };
+	for (int l = 0; l < 4; l++)
+	{
+		const SimdKernels& kernels = simdKernels(levels[l]);
+		if (kernels.level != levels[l]) continue;
+
+		kernels.sdf(packed, px.data(), py.data(), pz.data(), out.data(), opt.points);
+		float err = 0.0f;
+		for (int i = 0; i < opt.points; i++)
+		{
+			if (isfinite(ref[i])) err = max(err, fabsf(out[i] - ref[i]));
+		}
+
+		// the kernel does the whole batch per call
+		double ns = timeNs(1, [&](int) { kernels.sdf(packed, px.data(), py.data(), pz.data(), out.data(), opt.points); }) / opt.points;
+
+		char name[64];
+		snprintf(name, sizeof(name), "packet (%s)", simdName(levels[l]));
+		printf("  %-24s %10.1f ns/point  (x%.2f, max err %g)\n", name, ns, trig / ns, err);
+	}
+}
+
+BenchReport::BenchReport(const string& format) : format(format)
+{
+	if (format == "csv") printf("suite,case,ns_per_op,rays_per_s,steps_per_s\n");
+}
+
+void BenchReport::row(const char* suite, const char* name, double nsPerOp, double raysPerSec, double stepsPerSec)
+{
+	if (format == "json")
+	{
+		printf("{\"suite\":\"%s\",\"case\":\"%s\",\"ns_per_op\":%.3f", suite, name, nsPerOp);
+		if (raysPerSec > 0.0) printf(",\"rays_per_s\":%.0f", raysPerSec);
+		if (stepsPerSec > 0.0) printf(",\"steps_per_s\":%.0f", stepsPerSec);
+		printf("}\n");
+	}
+	else if (format == "csv")
+	{
+		printf("%s,%s,%.3f,%.0f,%.0f\n", suite, name, nsPerOp, raysPerSec, stepsPerSec);
+	}
+	else
+	{
+		printf("  %-24s %12.1f ns/op", name, nsPerOp);
+		if (raysPerSec > 0.0) printf(" %8.2f Mrays/s", raysPerSec / 1e6);
+		if (stepsPerSec > 0.0) printf(" %8.2f Msteps/s", stepsPerSec / 1e6);
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
+// the engine's building blocks one at a time, for regression tracking.
+// Everything is seeded, so runs on the same machine are comparable
+void benchMicro(const BenchOptions& opt)
+{
+	BenchReport report(opt.format);
+	if (opt.format == "text") printf("micro: seed %u, k=%.2f\n", opt.seed, k);
+
+	vector<Vector3> pts;
+	randomPoints(opt.points, opt.seed + 1, pts);
+
+	// each primitive on its own
+	Shape* prims[4] = {
+		new Sphere({ 1.0f, 0.0f, 0.0f }, 1.0f),
+		new Box({ 0.0f, 1.0f, 0.0f }, { 1.0f, 0.5f, 1.5f }),
+		new Torus({ 0.0f, 0.0f, 1.0f }, { 1.0f, 0.3f }),
+		new Mandelbulb({ 0.0f, 0.0f, 0.0f }, { 8.0f, 1.0f, 8.0f })
+	};
+	const char* primNames[4] = { "Sphere::sdf", "Box::sdf", "Torus::sdf", "Mandelbulb::sdf" };
+	for (int s = 0; s < 4; s++)
+	{
+		double ns = timeNs(opt.points, [&](int i) { sink = prims[s]->sdf(pts[i]); });
+		report.row("sdf", primNames[s], ns);
+		delete prims[s];
+	}
+
+	// smin on distance pairs spread around the blend width
+	mt19937 rng(opt.seed + 2);
+	uniform_real_distribution<float> dist(-1.0f, 4.0f);
+	vector<float> a(opt.points), b(opt.points);
+	for (int i = 0; i < opt.points; i++)
+	{
+		a[i] = dist(rng);
+		b[i] = dist(rng);
+	}
+	report.row("smin", "smin", timeNs(opt.points, [&](int i) { sink = smin(a[i], b[i], k); }));
+
+	// the whole smooth union as the scene grows
+	int counts[] = { 1, 4, 16, 64, 256 };
+	for (int c = 0; c < 5; c++)
+	{
+		vector<Shape*> shapes;
+		randomScene(counts[c], opt.seed, shapes);
+
+		char name[64];
+		snprintf(name, sizeof(name), "SdfMinOfAll/%d", counts[c]);
+		report.row("scene", name, timeNs(opt.points, [&](int i) { sink = SdfMinOfAll(shapes.data(), pts[i], counts[c], k); }));
+
+		freeShapes(shapes);
+	}
+
+	// ray setup and full frames of a small random scene, viewed from outside it
+	vector<Shape*> shapes;
+	randomScene(8, opt.seed, shapes);
+	int count = (int)shapes.size();
+
+	Cam3d cam;
+	cam.origin = { 0.0f, 0.0f, 20.0f };
+
+	int sizes[][2] = { { 160, 120 }, { 320, 240 } };
+	for (int r = 0; r < 2; r++)
+	{
+		int w = sizes[r][0], h = sizes[r][1];
+		char name[64];
+
+		double initNs = timeNs(1, [&](int) { cam.initRays(w, h); });
+		snprintf(name, sizeof(name), "initRays/%dx%d", w, h);
+		report.row("rays", name, initNs, w * h * 1e9 / initNs);
+
+		auto frame = [&](int) {
+			cam.initRays(w, h);
+			for (int i = 0; i < cam.rays.count; i++) cam.marchRay(i, shapes.data(), count);
+		};
+		double frameNs = timeNs(1, frame);
+
+		// steps of one frame, the same every time
+		frame(0);
+		double steps = cam.rays.averageSteps() * cam.rays.count;
+
+		snprintf(name, sizeof(name), "marchRay/%dx%d", w, h);
+		report.row("frame", name, frameNs, w * h * 1e9 / frameNs, steps * 1e9 / frameNs);
+	}
+
+	freeShapes(shapes);
+}
+
+int runBenchmarks(const BenchOptions& opt)
+{
+	bool all = opt.suite == "all";
+	bool ran = false;
+
+	if (opt.k >= 0.0f) k = opt.k;
+
+	if (all || opt.suite == "store") { benchStore(opt); ran = true; }
+	if (all || opt.suite == "templates") { benchTemplates(opt); ran = true; }
+	if (all || opt.suite == "bvh") { benchBvh(opt); ran = true; }
+	if (all || opt.suite == "brickmap") { benchBrickMap(opt); ran = true; }
+	if (all || opt.suite == "smin") { benchSmin(opt); ran = true; }
+	if (all || opt.suite == "mandelbulb") { benchMandelbulb(opt); ran = true; }
+	if (all || opt.suite == "micro") { benchMicro(opt); ran = true; }
+
+	if (!ran)
+	{
+		fprintf(stderr, "BENCH: unknown suite %s\n", opt.suite.c_str());
+		return 1;
+	}
+	return 0;
+}
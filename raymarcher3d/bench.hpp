@@ -0,0 +1,49 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include "engine.hpp"
+#include <string>
+#include <vector>
+
+// CPU engine benchmarks, run with --bench <suite>
+
+struct BenchOptions
+{
+	bool enabled = false;
+	std::string suite = "all";
+	int shapes = 64;			// shapes in the random scene
+	int points = 1 << 16;		// sample points per case
+	unsigned seed = 1234;
+	float k = -1.0f;			// smoothness, < 0 keeps the app's default
+	float voxel = 0.1f;			// brick map voxel size
+	std::string format = "text";	// micro suite output: text, json (one object per line) or csv
+};
+
+// one line per measurement in the chosen format; 0 leaves a rate out
+class BenchReport
+{
+public:
+	explicit BenchReport(const std::string& format);
+
+	void row(const char* suite, const char* name, double nsPerOp, double raysPerSec = 0.0, double stepsPerSec = 0.0);
+
+private:
+	std::string format;
+};
+
+// Function declarations
+bool parseBenchArgs(int, char*[], BenchOptions&);	// true if --bench was given
+int runBenchmarks(const BenchOptions&);
+
+// (used by bench.cpp)
+void randomScene(int, unsigned, std::vector<Shape*>&);		// mixed spheres/boxes/tori
+void randomPoints(int, unsigned, std::vector<Vector3>&);
+void benchStore(const BenchOptions&);
+void benchTemplates(const BenchOptions&);
+void benchBvh(const BenchOptions&);
+void benchBrickMap(const BenchOptions&);
+void benchSmin(const BenchOptions&);
+void benchMandelbulb(const BenchOptions&);
+void benchMicro(const BenchOptions&);
+
+#endif
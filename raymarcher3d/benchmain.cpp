@@ -0,0 +1,18 @@
+#include "bench.hpp"
+
+// Standalone benchmark runner: the CPU engine suites without a window, GPU or
+// ImGui, so it builds and runs on any machine with a C++14 compiler and the
+// raylib headers. See "Benchmarks" in the README.
+
+float k = 1.0f;
+SminMode sminMode = SMIN_EXPONENTIAL;
+
+int main(int argc, char* argv[])
+{
+	BenchOptions opt;
+	opt.suite = "micro";
+	opt.format = "json";
+	parseBenchArgs(argc, argv, opt);
+
+	return runBenchmarks(opt);
+}
@@ -0,0 +1,149 @@
+#include "brickmap.hpp"
+#include "raymath.h"
+#include <math.h>
+
+using namespace std;
+
+bool BrickMap::bake(const function<float(Vector3)>& sdf, BoundingBox region, float voxelSize, int bits, float band, size_t maxBytes)
+{
+	this->voxelSize = voxelSize;
+	this->bits = (bits == 16) ? 16 : 8;
+	this->band = band;
+
+	Vector3 pad = { band, band, band };
+	bounds = { region.min - pad, region.max + pad };
+
+	float brickSize = voxelSize * brickRes;
+	Vector3 extent = bounds.max - bounds.min;
+	gridX = max(1, (int)ceilf(extent.x / brickSize));
+	gridY = max(1, (int)ceilf(extent.y / brickSize));
+	gridZ = max(1, (int)ceilf(extent.z / brickSize));
+
+	int cells = gridX * gridY * gridZ;
+	coarse.assign(cells, 0.0f);
+	brickIndex.assign(cells, -1);
+	samples.clear();
+	brickCount = 0;
+
+	int side = brickRes + 1;
+	int bytesPerBrick = side * side * side * (this->bits / 8);
+	float maxQ = (this->bits == 16) ? 65535.0f : 255.0f;
+
+	// half diagonal of a cell: any point in it is at most this far from the centre
+	float halfDiag = 0.5f * brickSize * sqrtf(3.0f);
+
+	for (int z = 0; z < gridZ; z++)
+	for (int y = 0; y < gridY; y++)
+	for (int x = 0; x < gridX; x++)
+	{
+		int cell = (z * gridY + y) * gridX + x;
+		Vector3 cellMin = bounds.min + Vector3{ x * brickSize, y * brickSize, z * brickSize };
+		Vector3 centre = cellMin + Vector3{ brickSize * 0.5f, brickSize * 0.5f, brickSize * 0.5f };
+
+		float d = sdf(centre);
+		coarse[cell] = d;
+
+		if (fabsf(d) >= halfDiag + band)
+		{
+			continue;
+		}
+
+		if (maxBytes > 0 && samples.size() + bytesPerBrick > maxBytes)
+		{
+			return false;
+		}
+
+		brickIndex[cell] = brickCount++;
+		size_t base = samples.size();
+		samples.resize(base + bytesPerBrick);
+
+		int i = 0;
+		for (int sz = 0; sz < side; sz++)
+		for (int sy = 0; sy < side; sy++)
+		for (int sx = 0; sx < side; sx++, i++)
+		{
+			Vector3 p = cellMin + Vector3{ sx * voxelSize, sy * voxelSize, sz * voxelSize };
+			float n = Clamp(sdf(p) / band * 0.5f + 0.5f, 0.0f, 1.0f);
+			unsigned q = (unsigned)(n * maxQ + 0.5f);
+
+			if (this->bits == 16)
+			{
+				samples[base + 2 * i] = (uint8_t)(q & 0xFF);
+				samples[base + 2 * i + 1] = (uint8_t)(q >> 8);
+			}
+			else
+			{
+				samples[base + i] = (uint8_t)q;
+			}
+		}
+	}
+	return true;
+}
+
+float BrickMap::sample(int brick, int x, int y, int z) const
+{
+	int side = brickRes + 1;
+	int i = (z * side + y) * side + x;
+
+	float n;
+	if (bits == 16)
+	{
+		size_t at = (size_t)brick * side * side * side * 2 + 2 * i;
+		n = (samples[at] | (samples[at + 1] << 8)) / 65535.0f;
+	}
+	else
+	{
+		n = samples[(size_t)brick * side * side * side + i] / 255.0f;
+	}
+	return (n * 2.0f - 1.0f) * band;
+}
+
+float BrickMap::sdf(Vector3 pt) const
+{
+	float brickSize = voxelSize * brickRes;
+	Vector3 local = (pt - bounds.min) / brickSize;
+
+	int cx = (int)floorf(local.x);
+	int cy = (int)floorf(local.y);
+	int cz = (int)floorf(local.z);
+
+	// outside the baked region: every surface is at least band inside it
+	if (cx < 0 || cy < 0 || cz < 0 || cx >= gridX || cy >= gridY || cz >= gridZ)
+	{
+		Vector3 q = Vector3Max(bounds.min - pt, pt - bounds.max);
+		return Vector3Length(Vector3Max(q, Vector3Zero())) + band;
+	}
+
+	int cell = (cz * gridY + cy) * gridX + cx;
+	int brick = brickIndex[cell];
+
+	if (brick < 0)
+	{
+		// no surface in this cell, so the SDF is 1-Lipschitz around the centre
+		Vector3 centre = bounds.min + Vector3{ (cx + 0.5f) * brickSize, (cy + 0.5f) * brickSize, (cz + 0.5f) * brickSize };
+		float r = Vector3Distance(pt, centre);
+		float d = coarse[cell];
+		return (d > 0.0f) ? d - r : d + r;
+	}
+
+	// trilinear lookup inside the brick
+	float fx = (local.x - cx) * brickRes;
+	float fy = (local.y - cy) * brickRes;
+	float fz = (local.z - cz) * brickRes;
+	int ix = min((int)fx, brickRes - 1);
+	int iy = min((int)fy, brickRes - 1);
+	int iz = min((int)fz, brickRes - 1);
+	float tx = fx - ix, ty = fy - iy, tz = fz - iz;
+
+	float c00 = Lerp(sample(brick, ix, iy, iz), sample(brick, ix + 1, iy, iz), tx);
+	float c10 = Lerp(sample(brick, ix, iy + 1, iz), sample(brick, ix + 1, iy + 1, iz), tx);
+	float c01 = Lerp(sample(brick, ix, iy, iz + 1), sample(brick, ix + 1, iy, iz + 1), tx);
+	float c11 = Lerp(sample(brick, ix, iy + 1, iz + 1), sample(brick, ix + 1, iy + 1, iz + 1), tx);
+
+	return Lerp(Lerp(c00, c10, ty), Lerp(c01, c11, ty), tz);
+}
+
+size_t BrickMap::memoryBytes() const
+{
+	return samples.size() + coarse.size() * sizeof(float) + brickIndex.size() * sizeof(int);
+}
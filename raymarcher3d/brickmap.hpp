@@ -0,0 +1,45 @@
+#ifndef BRICKMAP_HPP
+#define BRICKMAP_HPP
+
+#include "raylib.h"
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Sparse brick map: a baked, quantized SDF for static geometry.
+//
+// Space is split into a coarse grid of cells. Cells that can contain the
+// narrow band (|distance| < band) around a surface get a brick of
+// (brickRes + 1)^3 samples, quantized to 8 or 16 bits over [-band, band] and
+// read back with trilinear filtering. Every other cell only keeps the
+// distance at its centre, which gives a conservative bound anywhere in it.
+
+class BrickMap
+{
+public:
+	BoundingBox bounds;				// baked region, padded by the band
+	float voxelSize = 0.05f;
+	int brickRes = 8;				// voxels per brick edge
+	int bits = 8;					// 8 or 16
+	float band = 0.2f;				// narrow band half width
+
+	int gridX = 0, gridY = 0, gridZ = 0;
+	std::vector<float> coarse;		// distance at each cell centre
+	std::vector<int> brickIndex;	// brick of each cell, -1 = empty
+	std::vector<uint8_t> samples;	// all bricks, bits / 8 bytes per sample
+	int brickCount = 0;
+
+	// bake sdf over region (which must contain every surface);
+	// false if more than maxBytes would be needed (0 = no limit)
+	bool bake(const std::function<float(Vector3)>& sdf, BoundingBox region, float voxelSize, int bits, float band, size_t maxBytes = 0);
+
+	float sdf(Vector3) const;
+	size_t memoryBytes() const;
+	bool empty() const { return coarse.empty(); }
+
+private:
+	float sample(int brick, int x, int y, int z) const;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "bvh.hpp"
+#include "engine.hpp"
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+static BoundingBox merge(BoundingBox a, BoundingBox b)
+{
+	return { Vector3Min(a.min, b.min), Vector3Max(a.max, b.max) };
+}
+
+// signed distance from pt to the box. A shape inside the box can't be
+// further inside than this, so it is a lower bound on the shape's SDF
+static float boxDistance(const BoundingBox& b, Vector3 pt)
+{
+	float dx = std::max(b.min.x - pt.x, pt.x - b.max.x);
+	float dy = std::max(b.min.y - pt.y, pt.y - b.max.y);
+	float dz = std::max(b.min.z - pt.z, pt.z - b.max.z);
+
+	float ox = std::max(dx, 0.0f), oy = std::max(dy, 0.0f), oz = std::max(dz, 0.0f);
+	return sqrtf(ox * ox + oy * oy + oz * oz) + std::min(std::max(dx, std::max(dy, dz)), 0.0f);
+}
+
+void ShapeBVH::build(Shape* shapes[], int count)
+{
+	this->shapes = shapes;
+	shapeCount = count;
+
+	nodes.clear();
+	order.resize(count);
+	for (int i = 0; i < count; i++) order[i] = i;
+
+	if (count > 0)
+	{
+		nodes.reserve(2 * count);
+		buildNode(0, count);
+	}
+}
+
+// median split on the widest axis of the shape centres
+int ShapeBVH::buildNode(int first, int count)
+{
+	int idx = (int)nodes.size();
+	nodes.push_back({});
+
+	BoundingBox box = shapes[order[first]]->bounds();
+	BoundingBox centres = { shapes[order[first]]->origin, shapes[order[first]]->origin };
+	for (int i = first + 1; i < first + count; i++)
+	{
+		box = merge(box, shapes[order[i]]->bounds());
+		centres = merge(centres, { shapes[order[i]]->origin, shapes[order[i]]->origin });
+	}
+
+	BvhNode node = { box, -1, -1, first, count };
+
+	if (count > leafSize)
+	{
+		Vector3 extent = centres.max - centres.min;
+		int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+
+		int mid = first + count / 2;
+		nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count,
+			[&](int a, int b)
+			{
+				Vector3 oa = shapes[a]->origin, ob = shapes[b]->origin;
+				return (axis == 0) ? oa.x < ob.x : (axis == 1 ? oa.y < ob.y : oa.z < ob.z);
+			});
+
+		node.left = buildNode(first, mid - first);
+		node.right = buildNode(mid, first + count - mid);
+	}
+
+	nodes[idx] = node;
+	return idx;
+}
+
+void ShapeBVH::refit()
+{
+	for (int i = (int)nodes.size() - 1; i >= 0; i--)
+	{
+		BvhNode& node = nodes[i];
+
+		if (node.left < 0)
+		{
+			node.box = shapes[order[node.first]]->bounds();
+			for (int j = node.first + 1; j < node.first + node.count; j++)
+			{
+				node.box = merge(node.box, shapes[order[j]]->bounds());
+			}
+		}
+		else
+		{
+			node.box = merge(nodes[node.left].box, nodes[node.right].box);
+		}
+	}
+}
+
+float ShapeBVH::sdf(Vector3 pt, float k) const
+{
+	int evaluated;
+	return sdf(pt, k, evaluated);
+}
+
+float ShapeBVH::sdf(Vector3 pt, float k, int& evaluated) const
+{
+	evaluated = 0;
+	if (nodes.empty()) return 1e6f;
+
+	float margin = (k <= 0.05f) ? 0.0f : blendScale * k;
+	float best = 1e30f;
+	SminAccumulator acc = { k };
+
+	int stack[64];
+	float stackDist[64];
+	int sp = 0;
+
+	stack[sp] = 0;
+	stackDist[sp++] = boxDistance(nodes[0].box, pt);
+
+	while (sp > 0)
+	{
+		sp--;
+		const BvhNode& node = nodes[stack[sp]];
+		float lb = stackDist[sp];
+
+		if (lb > best + margin)
+		{
+			acc.add(lb, (float)node.count);
+			continue;
+		}
+
+		if (node.left < 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				float d = shapes[order[i]]->sdf(pt);
+				acc.add(d);
+				best = min(best, d);
+				evaluated++;
+			}
+			continue;
+		}
+
+		// push the far child first so the near one is visited next
+		float dl = boxDistance(nodes[node.left].box, pt);
+		float dr = boxDistance(nodes[node.right].box, pt);
+		int nearChild = (dl <= dr) ? node.left : node.right;
+		int farChild = (dl <= dr) ? node.right : node.left;
+
+		stack[sp] = farChild;
+		stackDist[sp++] = max(dl, dr);
+		stack[sp] = nearChild;
+		stackDist[sp++] = min(dl, dr);
+	}
+
+	return acc.result();
+}
@@ -0,0 +1,47 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include "raylib.h"
+#include <vector>
+
+class Shape;
+
+// Bounding volume hierarchy over Shape::bounds() for culled scene SDF queries.
+//
+// A query walks the tree nearest-first and only evaluates shapes whose box
+// lies within blendScale * k of the closest distance found so far. Subtrees
+// further away are not evaluated; their box distance (a lower bound on every
+// shape inside) stands in for their shapes in the smooth union, so the result
+// never exceeds the full SdfMinOfAll and marching stays safe.
+
+struct BvhNode
+{
+	BoundingBox box;
+	int left;		// child nodes, -1 for leaves
+	int right;
+	int first;		// leaves: range into ShapeBVH::order
+	int count;		// shapes below this node
+};
+
+class ShapeBVH
+{
+public:
+	std::vector<BvhNode> nodes;		// parents before children, root at 0
+	std::vector<int> order;			// shape indices in leaf order
+	Shape** shapes = nullptr;
+	int shapeCount = 0;
+
+	float blendScale = 8.0f;		// cull margin in units of k
+	int leafSize = 2;
+
+	void build(Shape*[], int);		// keeps a pointer to the shape array
+	void refit();					// recompute bounds after shapes move, same topology
+
+	float sdf(Vector3, float) const;
+	float sdf(Vector3, float, int&) const;		// also counts shapes evaluated
+
+private:
+	int buildNode(int first, int count);
+};
+
+#endif
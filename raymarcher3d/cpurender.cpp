@@ -0,0 +1,326 @@
+#include "cpurender.hpp"
+#include "trace.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+
+bool parseHeadlessArgs(int argc, char* argv[], HeadlessOptions& opt)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--headless") == 0) opt.enabled = true;
+		else if (strcmp(argv[i], "--png") == 0) opt.png = true;
+		else if (strcmp(argv[i], "--frames") == 0 && hasValue) opt.frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue) opt.threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--tile") == 0 && hasValue) opt.tileSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--scale") == 0 && hasValue) opt.scale = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--yaw") == 0 && hasValue) opt.yawStep = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--simd") == 0 && hasValue)
+		{
+			opt.simd = parseSimdLevel(argv[++i], opt.simdLevel);
+			if (!opt.simd) cout << "HEADLESS: unknown SIMD level " << argv[i] << endl;
+		}
+		else if (strcmp(argv[i], "--brickmap") == 0 && hasValue) opt.brickVoxel = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--brick-bits") == 0 && hasValue) opt.brickBits = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--relax") == 0 && hasValue) opt.relaxation = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--adaptive-eps") == 0) opt.adaptiveThreshold = true;
+		else if (strcmp(argv[i], "--depth-reuse") == 0 && hasValue) opt.depthReuse = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--smin") == 0 && hasValue)
+		{
+			if (!parseSminMode(argv[++i], sminMode)) cout << "HEADLESS: unknown smin " << argv[i] << endl;
+		}
+		else if (strcmp(argv[i], "--thread-stats") == 0) opt.threadStats = true;
+		else if (strcmp(argv[i], "--heatmap") == 0 && hasValue)
+		{
+			if (!parseHeatmapMode(argv[++i], opt.heatmap)) cout << "HEADLESS: unknown heatmap " << argv[i] << endl;
+		}
+		else if (strcmp(argv[i], "--heatmap-max") == 0 && hasValue) opt.heatmapMax = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--trace") == 0 && hasValue) opt.tracePath = argv[++i];
+		else if (strcmp(argv[i], "--out") == 0 && hasValue) opt.outPrefix = argv[++i];
+		else cout << "HEADLESS: unknown argument " << argv[i] << endl;
+	}
+
+	if (opt.frames < 1) opt.frames = 1;
+	if (opt.tileSize < 1) opt.tileSize = 32;
+	if (opt.scale <= 0.0f) opt.scale = 1.0f;
+	opt.relaxation = Clamp(opt.relaxation, 1.0f, 1.99f);
+	opt.depthReuse = Clamp(opt.depthReuse, 0.0f, 1.0f);
+
+	return opt.enabled;
+}
+
+static float saturate(float f)
+{
+	return Clamp(f, 0.0f, 1.0f);
+}
+
+static unsigned char toByte(float f)
+{
+	return (unsigned char)(saturate(f) * 255.0f + 0.5f);
+}
+
+static Vector3 getNormal(Shape* shapes[], Vector3 pt, int size)
+{
+	const float EPS = 0.001f;
+
+	Vector3 v1 = {
+		SdfMinOfAll(shapes, pt + Vector3{ EPS, 0.0f, 0.0f }, size, k, sminMode),
+		SdfMinOfAll(shapes, pt + Vector3{ 0.0f, EPS, 0.0f }, size, k, sminMode),
+		SdfMinOfAll(shapes, pt + Vector3{ 0.0f, 0.0f, EPS }, size, k, sminMode)
+	};
+	Vector3 v2 = {
+		SdfMinOfAll(shapes, pt - Vector3{ EPS, 0.0f, 0.0f }, size, k, sminMode),
+		SdfMinOfAll(shapes, pt - Vector3{ 0.0f, EPS, 0.0f }, size, k, sminMode),
+		SdfMinOfAll(shapes, pt - Vector3{ 0.0f, 0.0f, EPS }, size, k, sminMode)
+	};
+
+	return Vector3Normalize(v1 - v2);
+}
+
+// scene SDF evaluations shadeRay makes for a hit: getNormal + SdfColorOfAll
+static const int SHADE_EVALS = 7;
+
+// diffuse + ambient only, same terms as the shader minus shadows/AO/specular
+Color shadeRay(Vector3 hit, bool missed, Shape* shapes[], int size, CpuLighting light)
+{
+	Vector3 color = light.bgColor;
+
+	if (!missed)
+	{
+		Vector3 normal = getNormal(shapes, hit, size);
+		Vector3 toLight = Vector3Normalize(light.lightPos - hit);
+		float lighting = saturate(Vector3DotProduct(normal, toLight));
+
+		// blended across smooth-union seams like the shader's combine()
+		Vector4 scene = SdfColorOfAll(shapes, hit, size, k, sminMode);
+		Vector3 albedo = { scene.x, scene.y, scene.z };
+		color = (albedo + light.bgColor * 0.5f) * light.lightCol * lighting + light.bgColor * 0.5f;
+	}
+
+	return { toByte(color.x), toByte(color.y), toByte(color.z), 255 };
+}
+
+void renderFrameCPU(Cam3d& cam, Shape* shapes[], int size, CpuLighting light, vector<Color>& pixels, TileScheduler& scheduler,
+	int threads, int tileSize, const SimdKernels* simd, const PacketShape* packed, int packedCount, const BrickMap* baked)
+{
+	int width = cam.rays.width;
+	int height = cam.rays.height;
+	pixels.resize(width * height);
+
+	scheduler.run(width, height, tileSize, threads, [&](const TileRect& tile, int)
+	{
+		for (int y = tile.y0; y < tile.y1; y++)
+		{
+			if (simd)
+			{
+				// whole tile row steps together, then shade per pixel
+				simd->march(rayLanes(cam.rays), y * width + tile.x0, tile.x1 - tile.x0, packed, packedCount, k, cam.hitThreshold, cam.clipEnd);
+			}
+
+			for (int x = tile.x0; x < tile.x1; x++)
+			{
+				int idx = y * width + x;
+				bool missed;
+				if (simd) missed = cam.rays.t[idx] > cam.clipEnd;
+				else if (baked) missed = cam.marchRay(idx, *baked) == 1;
+				else missed = cam.marchRay(idx, shapes, size) == 1;
+				pixels[idx] = shadeRay(cam.rays.position(idx), missed, shapes, size, light);
+				if (!missed) cam.rays.evals[idx] += SHADE_EVALS;
+			}
+		}
+	});
+}
+
+bool writeFrame(const vector<Color>& pixels, int width, int height, const string& path, bool png)
+{
+#ifndef HEADLESS_PPM_ONLY
+	if (png)
+	{
+		Image img = { (void*)pixels.data(), width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+		return ExportImage(img, path.c_str());
+	}
+#endif
+
+	FILE* f = fopen(path.c_str(), "wb");
+	if (!f)
+	{
+		return false;
+	}
+
+	fprintf(f, "P6\n%d %d\n255\n", width, height);
+	for (int i = 0; i < width * height; i++)
+	{
+		unsigned char rgb[3] = { pixels[i].r, pixels[i].g, pixels[i].b };
+		fwrite(rgb, 1, 3, f);
+	}
+	fclose(f);
+	return true;
+}
+
+int runHeadless(const HeadlessOptions& opt, Cam3d& cam, Shape* shapes[], int size, CpuLighting light)
+{
+	if (size <= 0)
+	{
+		cerr << "HEADLESS: no CPU-renderable shapes in scene" << endl;
+		return 1;
+	}
+
+	int threads = opt.threads;
+	if (threads <= 0) threads = (int)thread::hardware_concurrency();
+	if (threads <= 0) threads = 1;
+
+	bool png = opt.png;
+#ifdef HEADLESS_PPM_ONLY
+	// built without the raylib library, which ExportImage needs
+	if (png) cout << "HEADLESS: built with HEADLESS_PPM_ONLY, writing PPM instead of PNG" << endl;
+	png = false;
+#endif
+
+	int width = (int)(screenX * opt.scale);
+	int height = (int)(screenY * opt.scale);
+
+	const SimdKernels* simd = nullptr;
+	vector<PacketShape> packed(size);
+	if (opt.simd)
+	{
+		simd = &simdKernels(opt.simdLevel);
+		packed.resize(packShapes(shapes, size, packed.data()));
+
+		// a partial packet scene would render something else, march it all scalar
+		if ((int)packed.size() < size)
+		{
+			cout << "HEADLESS: --simd has no packet SDF for shape";
+			for (int i = 0; i < size; i++)
+			{
+				if (!packetSupported(shapes[i])) cout << " " << i;
+			}
+			cout << " (non-integer Mandelbulb power), using the scalar march" << endl;
+			simd = nullptr;
+			packed.clear();
+		}
+	}
+
+	BrickMap baked;
+	if (opt.brickVoxel > 0.0f && !simd)
+	{
+		SceneStore store;
+		store.build(shapes, size);
+
+		auto start = chrono::steady_clock::now();
+		baked.bake([&](Vector3 p) { return store.sdf(p, k); }, sceneBounds(shapes, size, k),
+			opt.brickVoxel, opt.brickBits, opt.brickVoxel * 4.0f);
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		cout << "HEADLESS: baked " << baked.brickCount << " bricks, " << baked.memoryBytes() / 1024 << " KiB in " << ms << " ms" << endl;
+	}
+
+	const char* marchName = simd ? simdName(simd->level) : (baked.empty() ? "virtual" : "brickmap");
+	cout << "HEADLESS: " << width << "x" << height << ", " << threads << " threads, "
+		<< opt.tileSize << "px tiles, " << marchName << " march, " << sminName(sminMode) << " smin, relaxation " << opt.relaxation
+		<< (opt.adaptiveThreshold ? ", adaptive hit threshold" : "") << endl;
+
+	if (simd && (opt.relaxation > 1.0f || opt.adaptiveThreshold || opt.depthReuse > 0.0f))
+	{
+		cout << "HEADLESS: --relax, --adaptive-eps and --depth-reuse only apply to the scalar march, ignored with --simd" << endl;
+	}
+	if (simd && opt.brickVoxel > 0.0f)
+	{
+		cout << "HEADLESS: --brickmap only applies to the scalar march, ignored with --simd" << endl;
+	}
+	if ((simd || !baked.empty()) && sminMode != SMIN_EXPONENTIAL)
+	{
+		cout << "HEADLESS: the SIMD and brick map marches use the exponential smin, --smin only affects shading" << endl;
+	}
+	bool reuseDepth = opt.depthReuse > 0.0f && !simd;
+	cam.relaxation = opt.relaxation;
+	cam.adaptiveThreshold = opt.adaptiveThreshold;
+
+	vector<Color> pixels;
+	TileScheduler scheduler;
+	DepthHistory history;
+	history.fraction = opt.depthReuse;
+	double totalMs = 0.0;
+
+	TraceRecorder trace;
+	if (!opt.tracePath.empty())
+	{
+		trace.nameThread(TRACE_TID_MAIN, "Main");
+		trace.start(1 << 20);
+		scheduler.trace = &trace;
+	}
+
+	for (int frame = 0; frame < opt.frames; frame++)
+	{
+		auto start = chrono::steady_clock::now();
+
+		cam.initRays(width, height);
+		if (reuseDepth) history.seed(cam);
+		renderFrameCPU(cam, shapes, size, light, pixels, scheduler, threads, opt.tileSize, simd, packed.data(), (int)packed.size(),
+			baked.empty() ? nullptr : &baked);
+
+		if (reuseDepth) history.store(cam);
+
+		chrono::steady_clock::time_point end = chrono::steady_clock::now();
+		double ms = chrono::duration<double, milli>(end - start).count();
+		totalMs += ms;
+		trace.record("Frame", "frame", TRACE_TID_MAIN, start, end);
+
+		if (opt.heatmap != HEATMAP_OFF)
+		{
+			const int* counts = (opt.heatmap == HEATMAP_STEPS) ? cam.rays.steps : cam.rays.evals;
+			int maxValue = (opt.heatmapMax > 0) ? opt.heatmapMax : maxCount(counts, cam.rays.count);
+			overlayHeatmap(pixels, counts, maxValue, 0.75f);
+		}
+
+		char path[512];
+		snprintf(path, sizeof(path), "%s_%04d.%s", opt.outPrefix.c_str(), frame, png ? "png" : "ppm");
+		if (!writeFrame(pixels, width, height, path, png))
+		{
+			cerr << "HEADLESS: failed to write " << path << endl;
+			return 1;
+		}
+
+		cout << "frame " << frame << ": " << ms << " ms, " << cam.rays.averageSteps() << " steps/ray, "
+			<< cam.rays.averageEvals() << " evals/ray -> " << path << endl;
+
+		if (opt.heatmap != HEATMAP_OFF)
+		{
+			const char* names[2] = { "steps", "evals" };
+			const int* counts[2] = { cam.rays.steps, cam.rays.evals };
+			for (int c = 0; c < 2; c++)
+			{
+				snprintf(path, sizeof(path), "%s_%04d_%s.pgm", opt.outPrefix.c_str(), frame, names[c]);
+				if (!writeCounts(counts[c], width, height, path))
+				{
+					cerr << "HEADLESS: failed to write " << path << endl;
+					return 1;
+				}
+			}
+		}
+		if (reuseDepth) cout << "  depth reuse: " << history.seeded << " rays seeded, " << history.rejected << " from the camera" << endl;
+		if (opt.threadStats) scheduler.printStats();
+
+		cam.rotate(true, opt.yawStep);
+	}
+
+	if (!opt.tracePath.empty())
+	{
+		trace.stop();
+		if (!trace.write(opt.tracePath))
+		{
+			cerr << "HEADLESS: failed to write " << opt.tracePath << endl;
+			return 1;
+		}
+		cout << "HEADLESS: wrote " << trace.size() << " trace events to " << opt.tracePath << endl;
+	}
+
+	double raysPerSec = (double)width * height * opt.frames / (totalMs / 1000.0);
+	cout << "HEADLESS: avg " << totalMs / opt.frames << " ms/frame, " << raysPerSec << " rays/s" << endl;
+	return 0;
+}
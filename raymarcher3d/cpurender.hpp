@@ -0,0 +1,55 @@
+#ifndef CPURENDER_HPP
+#define CPURENDER_HPP
+
+#include "engine.hpp"
+#include "depthhistory.hpp"
+#include "heatmap.hpp"
+#include "simd.hpp"
+#include "tilescheduler.hpp"
+#include <string>
+#include <vector>
+
+// Headless CPU renderer built on Cam3d::initRays / Cam3d::marchRay
+
+struct HeadlessOptions
+{
+	bool enabled = false;
+	int frames = 1;				// frames to render
+	int threads = 0;			// 0 = all cores
+	int tileSize = 32;			// tile edge in pixels
+	float scale = 1.0f;			// render resolution relative to screenX/screenY
+	float yawStep = 0.0f;		// camera yaw per frame (Cam3d::rotate units)
+	bool png = false;			// PNG instead of PPM
+	bool simd = false;			// march with the packet kernels
+	SimdLevel simdLevel = SIMD_SCALAR;
+	float brickVoxel = 0.0f;	// > 0: bake the scene to a brick map and march that
+	int brickBits = 8;
+	float relaxation = 1.0f;	// sphere tracing over-relaxation (Cam3d::relaxation)
+	bool adaptiveThreshold = false;	// Cam3d::adaptiveThreshold
+	float depthReuse = 0.0f;	// > 0: start rays at this fraction of last frame's reprojected depth
+	bool threadStats = false;	// print per thread busy/idle time each frame
+	HeatmapMode heatmap = HEATMAP_OFF;	// overlay per pixel cost and dump the raw counts
+	int heatmapMax = 0;			// count drawn red, 0 = the frame's maximum
+	std::string tracePath;		// write frames and per thread tiles as trace-event JSON here
+	std::string outPrefix = "frame";
+};
+
+// shading inputs shared with the GPU path
+struct CpuLighting
+{
+	Vector3 lightPos;
+	Vector3 lightCol;
+	Vector3 bgColor;
+};
+
+// Function declarations
+bool parseHeadlessArgs(int, char*[], HeadlessOptions&);	// true if --headless was given
+int runHeadless(const HeadlessOptions&, Cam3d&, Shape*[], int, CpuLighting);
+
+// tiles across threads through the scheduler, uses cam.rays; marches with the packet kernels when given
+void renderFrameCPU(Cam3d&, Shape*[], int, CpuLighting, std::vector<Color>&, TileScheduler&, int, int,
+	const SimdKernels* = nullptr, const PacketShape* = nullptr, int = 0, const BrickMap* = nullptr);
+Color shadeRay(Vector3, bool, Shape*[], int, CpuLighting);
+bool writeFrame(const std::vector<Color>&, int, int, const std::string&, bool);			// PPM or PNG
+
+#endif
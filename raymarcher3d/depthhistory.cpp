@@ -0,0 +1,97 @@
+#include "depthhistory.hpp"
+#include "engine.hpp"
+#include <math.h>
+
+using namespace std;
+
+CamBasis camBasis(Cam3d& cam, int width, int height)
+{
+	CamBasis b;
+	b.origin = cam.origin;
+	b.forward = cam.forward();
+	b.right = cam.right();
+	b.up = cam.up();
+	b.halfHeight = tanf(cam.fov / 2.0f);
+	b.halfWidth = (float)width / (float)height * b.halfHeight;
+	b.width = width;
+	b.height = height;
+	return b;
+}
+
+Vector3 CamBasis::rayDir(int x, int y) const
+{
+	float u01 = (x + 0.5f) / width;
+	float v01 = (y + 0.5f) / height;
+
+	float px = (2.0f * u01 - 1.0f) * halfWidth;
+	float py = (1.0f - 2.0f * v01) * halfHeight;
+
+	return Vector3Normalize(forward + right * px + up * py);
+}
+
+void DepthHistory::store(Cam3d& cam)
+{
+	RayBuffer& rays = cam.rays;
+	depth.assign(rays.t, rays.t + rays.count);
+	prev = camBasis(cam, rays.width, rays.height);
+	clipEnd = cam.clipEnd;
+	valid = true;
+}
+
+// start distance for pixel (x, y) of cam, 0 = march from the camera
+float DepthHistory::reproject(const CamBasis& cam, int x, int y) const
+{
+	float guess = depth[y * prev.width + x];
+	if (guess > clipEnd) return 0.0f;
+
+	Vector3 v = cam.origin + cam.rayDir(x, y) * guess - prev.origin;
+	float z = Vector3DotProduct(v, prev.forward);
+	if (z <= 0.0f) return 0.0f;
+
+	// inverse of initRays' pixel -> direction mapping
+	float u01 = (Vector3DotProduct(v, prev.right) / z / prev.halfWidth + 1.0f) * 0.5f;
+	float v01 = (1.0f - Vector3DotProduct(v, prev.up) / z / prev.halfHeight) * 0.5f;
+	int px = (int)floorf(u01 * prev.width);
+	int py = (int)floorf(v01 * prev.height);
+
+	float nearest = 1e30f;
+	for (int j = py - 1; j <= py + 1; j++)
+	{
+		for (int i = px - 1; i <= px + 1; i++)
+		{
+			if (i < 0 || j < 0 || i >= prev.width || j >= prev.height) return 0.0f;
+
+			float d = depth[j * prev.width + i];
+			if (d > clipEnd) return 0.0f;
+
+			Vector3 hit = prev.origin + prev.rayDir(i, j) * d;
+			nearest = fminf(nearest, Vector3Distance(hit, cam.origin));
+		}
+	}
+	return nearest * fraction;
+}
+
+void DepthHistory::seed(Cam3d& cam)
+{
+	RayBuffer& rays = cam.rays;
+	seeded = rejected = 0;
+
+	if (!valid || rays.width != prev.width || rays.height != prev.height)
+	{
+		valid = false;
+		rejected = rays.count;
+		return;
+	}
+
+	CamBasis now = camBasis(cam, rays.width, rays.height);
+
+	for (int y = 0; y < rays.height; y++)
+	{
+		for (int x = 0; x < rays.width; x++)
+		{
+			float start = reproject(now, x, y);
+			rays.t[y * rays.width + x] = start;
+			(start > 0.0f) ? seeded++ : rejected++;
+		}
+	}
+}
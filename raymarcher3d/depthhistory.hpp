@@ -0,0 +1,58 @@
+#ifndef DEPTHHISTORY_HPP
+#define DEPTHHISTORY_HPP
+
+#include "raylib.h"
+#include <vector>
+
+class Cam3d;
+
+// Temporal depth reuse for the CPU path.
+//
+// After a frame, store() keeps the hit distance of every ray and the camera
+// it was rendered with. Before the next frame, seed() pushes each new ray's
+// guess point (its old distance at the same pixel) into the old camera, looks
+// at the 3x3 old pixels around where it lands and starts the ray at fraction
+// times the distance to the nearest of those hits. If the guess leaves the old
+// view or any tap missed (a silhouette the ray might now slip past), the ray
+// starts at the camera. Cam3d::marchRayWith also restarts a seed that lands
+// inside geometry, so a bad seed costs steps, never a wrong hit, as long
+// as only the camera moved. A shape moved or added in front of an old hit
+// would be stepped over from outside, so reset() whenever the scene or k
+// changes between store() and seed().
+
+// camera basis matching Cam3d::initRays
+struct CamBasis
+{
+	Vector3 origin;
+	Vector3 forward, right, up;
+	float halfWidth, halfHeight;
+	int width, height;
+
+	Vector3 rayDir(int x, int y) const;
+};
+
+class DepthHistory
+{
+public:
+	float fraction = 0.8f;		// of the reprojected distance to start at
+
+	int seeded = 0;				// rays of the last seed() that got a start distance
+	int rejected = 0;			// rays that had to march from the camera
+
+	void store(Cam3d&);			// after rendering into cam.rays
+	void seed(Cam3d&);			// after cam.initRays, before marching
+	void reset() { valid = false; }
+
+private:
+	std::vector<float> depth;	// distance along each old ray, > clipEnd = miss
+	CamBasis prev;
+	float clipEnd = 0.0f;
+	bool valid = false;
+
+	float reproject(const CamBasis& cam, int x, int y) const;
+};
+
+// Function declarations
+CamBasis camBasis(Cam3d&, int width, int height);
+
+#endif
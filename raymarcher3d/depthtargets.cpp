@@ -0,0 +1,53 @@
+#include "depthtargets.hpp"
+#include "rlgl.h"
+
+void DepthTargets::resize(int width, int height)
+{
+	if (width == this->width && height == this->height && textures[0] != 0)
+	{
+		return;
+	}
+
+	unload();
+	this->width = width;
+	this->height = height;
+
+	for (int i = 0; i < 2; i++)
+	{
+		textures[i] = rlLoadTexture(nullptr, width, height, RL_PIXELFORMAT_UNCOMPRESSED_R32, 1);
+	}
+}
+
+void DepthTargets::attach(const RenderTexture2D& target)
+{
+	rlFramebufferAttach(target.id, textures[current], RL_ATTACHMENT_COLOR_CHANNEL1, RL_ATTACHMENT_TEXTURE2D, 0);
+
+	// draw buffers are framebuffer state, so this sticks for BeginTextureMode
+	rlEnableFramebuffer(target.id);
+	rlActiveDrawBuffers(2);
+	rlDisableFramebuffer();
+}
+
+Texture2D DepthTargets::previous() const
+{
+	return { textures[1 - current], width, height, 1, PIXELFORMAT_UNCOMPRESSED_R32 };
+}
+
+void DepthTargets::endFrame(Vector3 camOrigin, Vector3 camDir)
+{
+	prevOrigin = camOrigin;
+	prevDir = camDir;
+	current = 1 - current;
+	valid = true;
+}
+
+void DepthTargets::unload()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		if (textures[i] != 0) rlUnloadTexture(textures[i]);
+		textures[i] = 0;
+	}
+	width = height = 0;
+	valid = false;
+}
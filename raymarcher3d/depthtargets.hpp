@@ -0,0 +1,29 @@
+#ifndef DEPTHTARGETS_HPP
+#define DEPTHTARGETS_HPP
+
+#include "raylib.h"
+
+// GPU side of temporal depth reuse: two R32F textures, ping-ponged.
+// raymarcher3d.fs writes each ray's hit distance to colour attachment 1 of
+// the scene target and reads last frame's from the other texture.
+
+class DepthTargets
+{
+public:
+	unsigned int textures[2] = { 0, 0 };
+	int width = 0;
+	int height = 0;
+	int current = 0;			// written this frame, the other holds last frame
+	bool valid = false;			// previous texture holds a frame at this size
+
+	Vector3 prevOrigin = { 0.0f, 0.0f, 0.0f };	// camera of the previous frame
+	Vector3 prevDir = { 0.0f, 0.0f, -1.0f };
+
+	void resize(int width, int height);				// recreates on change and drops the history
+	void attach(const RenderTexture2D& target);		// current texture as colour attachment 1
+	Texture2D previous() const;
+	void endFrame(Vector3 camOrigin, Vector3 camDir);	// swap, remember the camera
+	void unload();
+};
+
+#endif
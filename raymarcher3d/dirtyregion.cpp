@@ -0,0 +1,209 @@
+#include "dirtyregion.hpp"
+#include "engine.hpp"
+#include <math.h>
+#include <string.h>
+
+using namespace std;
+
+BoundingBox shaderShapeBounds(int type, Vector3 position, Vector3 size)
+{
+	// the shader evaluates shapes at pt + origin, so they sit at -position
+	Vector3 c = Vector3Negate(position);
+	Vector3 e;
+
+	switch (type)
+	{
+		case SHAPE_TYPE_SPHERE: e = { size.x, size.x, size.x }; break;
+		case SHAPE_TYPE_BOX: e = size; break;
+		case SHAPE_TYPE_TORUS: e = { size.x + size.y, size.y, size.x + size.y }; break;
+		case SHAPE_TYPE_MANDELBULB: e = { 2.0f * size.y, 2.0f * size.y, 2.0f * size.y }; break;	// escape radius
+		default: e = { 0.0f, 0.0f, 0.0f }; break;
+	}
+	return { c - e, c + e };
+}
+
+static BoundingBox merge(BoundingBox a, BoundingBox b)
+{
+	return { Vector3Min(a.min, b.min), Vector3Max(a.max, b.max) };
+}
+
+// shader camera basis and the inverse of its pixel -> direction mapping
+struct Projector
+{
+	Vector3 origin, forward, right, up;
+	float halfWidth, halfHeight;
+	int width, height;
+
+	// false if the point is behind the camera
+	bool project(Vector3 p, float& px, float& py) const
+	{
+		Vector3 v = p - origin;
+		float z = Vector3DotProduct(v, forward);
+		if (z < 0.01f) return false;
+
+		float u = (Vector3DotProduct(v, right) / z / halfWidth + 1.0f) * 0.5f;
+		float w = (1.0f - Vector3DotProduct(v, up) / z / halfHeight) * 0.5f;
+		px = u * width - 1.0f;
+		py = w * height - 1.0f;
+		return true;
+	}
+};
+
+// screen rect of box, extruded away from the light by shadowLength;
+// false if it can't be bounded on screen
+static bool projectBox(const Projector& proj, BoundingBox box, Vector3 lightPos, float shadowLength, ScreenRect& rect)
+{
+	if (lightPos.x >= box.min.x && lightPos.y >= box.min.y && lightPos.z >= box.min.z &&
+		lightPos.x <= box.max.x && lightPos.y <= box.max.y && lightPos.z <= box.max.z)
+	{
+		return false;
+	}
+
+	float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+
+	for (int i = 0; i < 8; i++)
+	{
+		Vector3 corner = {
+			(i & 1) ? box.max.x : box.min.x,
+			(i & 2) ? box.max.y : box.min.y,
+			(i & 4) ? box.max.z : box.min.z
+		};
+		Vector3 shadow = corner + Vector3Normalize(corner - lightPos) * shadowLength;
+
+		Vector3 pts[2] = { corner, shadow };
+		for (int j = 0; j < 2; j++)
+		{
+			float px, py;
+			if (!proj.project(pts[j], px, py)) return false;
+
+			minX = fminf(minX, px); maxX = fmaxf(maxX, px);
+			minY = fminf(minY, py); maxY = fmaxf(maxY, py);
+		}
+	}
+
+	// a couple of pixels of slack for rounding
+	rect.x0 = max(0, (int)floorf(minX) - 2);
+	rect.y0 = max(0, (int)floorf(minY) - 2);
+	rect.x1 = min(proj.width, (int)ceilf(maxX) + 3);
+	rect.y1 = min(proj.height, (int)ceilf(maxY) + 3);
+	return true;
+}
+
+void DirtyTracker::addRect(ScreenRect r)
+{
+	if (r.x1 <= r.x0 || r.y1 <= r.y0) return;
+
+	if ((int)rects.size() < maxRects)
+	{
+		rects.push_back(r);
+		return;
+	}
+
+	ScreenRect& u = rects[0];
+	for (int i = 1; i < rects.size(); i++)
+	{
+		u.x0 = min(u.x0, rects[i].x0); u.y0 = min(u.y0, rects[i].y0);
+		u.x1 = max(u.x1, rects[i].x1); u.y1 = max(u.y1, rects[i].y1);
+	}
+	u.x0 = min(u.x0, r.x0); u.y0 = min(u.y0, r.y0);
+	u.x1 = max(u.x1, r.x1); u.y1 = max(u.y1, r.y1);
+	rects.resize(1);
+}
+
+bool DirtyTracker::update(const int types[], const Vector3 positions[], const Vector3 sizes[], const Vector3 cols[], int count,
+	const void* globals, size_t globalsBytes,
+	Vector3 camOrigin, Vector3 camDir, float fov, Vector3 lightPos, float margin, int width, int height)
+{
+	rects.clear();
+
+	const unsigned char* g = (const unsigned char*)globals;
+	full = !hasHistory || width != this->width || height != this->height || count != (int)this->types.size()
+		|| this->globals.size() != globalsBytes || memcmp(this->globals.data(), g, globalsBytes) != 0;
+
+	if (!full && count > 0)
+	{
+		Projector proj;
+		proj.origin = camOrigin;
+		proj.forward = Vector3Normalize(camDir);
+		proj.right = Vector3Normalize(Vector3CrossProduct({ 0.0f, 1.0f, 0.0f }, proj.forward));
+		proj.up = Vector3CrossProduct(proj.forward, proj.right);
+		proj.halfHeight = tanf(fov / 2.0f);
+		proj.halfWidth = (float)width / (float)height * proj.halfHeight;
+		proj.width = width;
+		proj.height = height;
+
+		// a shadow can only land on another shape, so it never reaches
+		// further than the bounds of the whole scene, old and new
+		BoundingBox scene = shaderShapeBounds(types[0], positions[0], sizes[0]);
+		for (int i = 0; i < count; i++)
+		{
+			scene = merge(scene, shaderShapeBounds(types[i], positions[i], sizes[i]));
+			scene = merge(scene, shaderShapeBounds(this->types[i], this->positions[i], this->sizes[i]));
+		}
+		float shadowLength = Vector3Distance(scene.min, scene.max) + 2.0f * margin;
+
+		Vector3 pad = { margin, margin, margin };
+
+		for (int i = 0; i < count && !full; i++)
+		{
+			bool changed = types[i] != this->types[i] || !Vector3Equals(positions[i], this->positions[i])
+				|| !Vector3Equals(sizes[i], this->sizes[i]) || !Vector3Equals(cols[i], this->cols[i]);
+			if (!changed) continue;
+
+			BoundingBox box = merge(shaderShapeBounds(types[i], positions[i], sizes[i]),
+				shaderShapeBounds(this->types[i], this->positions[i], this->sizes[i]));
+			box = { box.min - pad, box.max + pad };
+
+			ScreenRect rect;
+			if (!projectBox(proj, box, lightPos, shadowLength, rect))
+			{
+				full = true;
+				break;
+			}
+			addRect(rect);
+		}
+	}
+
+	if (full)
+	{
+		rects.clear();
+		rects.push_back({ 0, 0, width, height });
+	}
+
+	this->types.assign(types, types + count);
+	this->positions.assign(positions, positions + count);
+	this->sizes.assign(sizes, sizes + count);
+	this->cols.assign(cols, cols + count);
+	this->globals.assign(g, g + globalsBytes);
+	this->width = width;
+	this->height = height;
+	hasHistory = true;
+
+	return !rects.empty();
+}
+
+int DirtyTracker::dirtyPixels() const
+{
+	int total = 0;
+	for (int i = 0; i < rects.size(); i++)
+	{
+		total += (rects[i].x1 - rects[i].x0) * (rects[i].y1 - rects[i].y0);
+	}
+	return total;
+}
+
+bool SceneHistory::changed(const int types[], const Vector3 positions[], const Vector3 sizes[], int count, float k)
+{
+	bool changed = !hasHistory || count != (int)this->types.size() || k != this->k;
+	for (int i = 0; i < count && !changed; i++)
+	{
+		changed = types[i] != this->types[i] || !Vector3Equals(positions[i], this->positions[i]) || !Vector3Equals(sizes[i], this->sizes[i]);
+	}
+
+	this->types.assign(types, types + count);
+	this->positions.assign(positions, positions + count);
+	this->sizes.assign(sizes, sizes + count);
+	this->k = k;
+	hasHistory = true;
+	return changed;
+}
@@ -0,0 +1,78 @@
+#ifndef DIRTYREGION_HPP
+#define DIRTYREGION_HPP
+
+#include "raylib.h"
+#include <stddef.h>
+#include <vector>
+
+// Dirty-region tracking for the shader path.
+//
+// Each frame the shape arrays are compared with the last frame. For every
+// shape that changed, its old and new bounds are inflated by the smooth-min
+// blend width and AO reach, extruded away from the light to cover the shadow
+// they cast, and projected to the screen. Only those rectangles need to be
+// re-marched into the persistent scene target. Anything else changing (camera,
+// lighting, render settings, shape count) re-renders the whole frame.
+//
+// Not covered: the faint glow a shape adds to rays passing far from it, and
+// the soft shadow penumbra past the extruded bounds.
+
+// pixels at render resolution, same origin as gl_FragCoord, max exclusive
+struct ScreenRect
+{
+	int x0, y0;
+	int x1, y1;
+};
+
+class DirtyTracker
+{
+public:
+	std::vector<ScreenRect> rects;	// to re-render this frame
+	bool full = true;				// whole frame
+	int maxRects = 8;				// more than this and they are merged into one
+
+	// true if anything must be re-rendered; globals is every other input
+	// to the frame (camera, lights, settings), compared bytewise
+	bool update(const int types[], const Vector3 positions[], const Vector3 sizes[], const Vector3 cols[], int count,
+		const void* globals, size_t globalsBytes,
+		Vector3 camOrigin, Vector3 camDir, float fov, Vector3 lightPos, float margin, int width, int height);
+
+	void invalidate() { hasHistory = false; }
+	int dirtyPixels() const;
+
+private:
+	std::vector<int> types;
+	std::vector<Vector3> positions;
+	std::vector<Vector3> sizes;
+	std::vector<Vector3> cols;
+	std::vector<unsigned char> globals;
+	bool hasHistory = false;
+	int width = 0;
+	int height = 0;
+
+	void addRect(ScreenRect);
+};
+
+// The scene geometry as of the last frame, for temporal depth reuse: old
+// hit distances are only safe seeds while nothing but the camera moves. A
+// shape moved in front of an old hit would be stepped over, and since the
+// seed lands outside geometry the march can't tell. Colours don't matter.
+class SceneHistory
+{
+public:
+	// true if shapes, their count or k differ from the last call (or there
+	// was none); remembers them either way
+	bool changed(const int types[], const Vector3 positions[], const Vector3 sizes[], int count, float k);
+
+private:
+	std::vector<int> types;
+	std::vector<Vector3> positions;
+	std::vector<Vector3> sizes;
+	float k = 0.0f;
+	bool hasHistory = false;
+};
+
+// Function declarations
+BoundingBox shaderShapeBounds(int type, Vector3 position, Vector3 size);	// as raymarcher3d.fs sees it
+
+#endif
@@ -0,0 +1,319 @@
+#include "engine.hpp"
+#include <math.h>
+#include <string.h>
+
+using namespace std;
+
+Vector3 absVec(Vector3 v)
+{
+	return {
+		abs(v.x),
+		abs(v.y),
+		abs(v.z)
+	};
+}
+
+// COMBINE SHAPES
+float min(float a, float b)
+{
+	return (a < b) ? a : b;
+}
+float smin(float a, float b, float k)
+{
+	if (k <= 0.05) { return min(a, b); }
+
+	k *= 1.0;
+	float r = exp2(-a / k) + exp2(-b / k);
+	return -k * log2(r);
+}
+
+float SdfMinOfAll(Shape* shapes[], Vector3 pt, int length, float k)
+{
+	float min = shapes[0]->sdf(pt);
+
+	for (int idx = 1; idx < length; idx++)
+	{
+		min = smin(min, shapes[idx]->sdf(pt), k);
+	}
+
+	return min;
+}
+
+float sminRadius(float k, SminMode mode)
+{
+	switch (mode)
+	{
+		case SMIN_POLYNOMIAL: return 4.0f * k;
+		case SMIN_CUBIC: return 6.0f * k;
+		case SMIN_EXPONENTIAL: return (k <= 0.05f) ? 0.0f : 24.0f * k;	// 2^-24 is below float precision
+		default: return 0.0f;
+	}
+}
+
+Vector2 sminBlend(float a, float b, float k, SminMode mode)
+{
+	float diff = fabsf(a - b);
+	float radius = sminRadius(k, mode);
+
+	if (diff >= radius)
+	{
+		return (a < b) ? Vector2{ a, 0.0f } : Vector2{ b, 1.0f };
+	}
+
+	float m, s;
+	switch (mode)
+	{
+		case SMIN_POLYNOMIAL:
+		{
+			float h = 1.0f - diff / radius;
+			m = h * h * 0.5f;
+			s = h * h * k;
+			break;
+		}
+		case SMIN_CUBIC:
+		{
+			float h = 1.0f - diff / radius;
+			m = h * h * h * 0.5f;
+			s = m * radius * (1.0f / 3.0f);
+			break;
+		}
+		default:
+		{
+			// relative to the smaller distance so exp2 stays in range
+			float e = exp2f(-diff / k);
+			s = k * log2f(1.0f + e);
+			m = e / (1.0f + e);
+			break;
+		}
+	}
+	return (a < b) ? Vector2{ a - s, m } : Vector2{ b - s, 1.0f - m };
+}
+
+Vector4 combine(float dstA, float dstB, Vector3 colA, Vector3 colB, float k, SminMode mode)
+{
+	Vector2 blend = sminBlend(dstA, dstB, k, mode);
+	Vector3 col = Vector3Lerp(colA, colB, blend.y);
+	return { col.x, col.y, col.z, blend.x };
+}
+
+float SdfMinOfAll(Shape* shapes[], Vector3 pt, int length, float k, SminMode mode)
+{
+	float min = shapes[0]->sdf(pt);
+
+	for (int idx = 1; idx < length; idx++)
+	{
+		min = sminBlend(min, shapes[idx]->sdf(pt), k, mode).x;
+	}
+
+	return min;
+}
+
+Vector4 SdfColorOfAll(Shape* shapes[], Vector3 pt, int length, float k, SminMode mode)
+{
+	Vector4 total = { 0.0f, 0.0f, 0.0f, 1e6f };
+
+	for (int idx = 0; idx < length; idx++)
+	{
+		total = combine(total.w, shapes[idx]->sdf(pt), { total.x, total.y, total.z }, shapes[idx]->col, k, mode);
+	}
+
+	return total;
+}
+
+bool parseSminMode(const char* name, SminMode& mode)
+{
+	if (strcmp(name, "exp") == 0) mode = SMIN_EXPONENTIAL;
+	else if (strcmp(name, "poly") == 0) mode = SMIN_POLYNOMIAL;
+	else if (strcmp(name, "cubic") == 0) mode = SMIN_CUBIC;
+	else if (strcmp(name, "hard") == 0) mode = SMIN_HARD;
+	else return false;
+	return true;
+}
+
+const char* sminName(SminMode mode)
+{
+	switch (mode)
+	{
+		case SMIN_POLYNOMIAL: return "poly";
+		case SMIN_CUBIC: return "cubic";
+		case SMIN_HARD: return "hard";
+		default: return "exp";
+	}
+}
+
+Vector2 oneDtoTwoD(int index, int rowSize)
+{
+	int x = index % rowSize;
+	int y = index / rowSize;
+	return { (float)x, (float)y };
+
+}
+
+bool mandelbulbIntegerPower(float power)
+{
+	return power >= 1.0f && power <= 32.0f && power == floorf(power);
+}
+
+// (c + i s)^n by repeated squaring
+static void complexPow(float& c, float& s, int n)
+{
+	float rc = 1.0f, rs = 0.0f;
+	while (n > 0)
+	{
+		if (n & 1)
+		{
+			float t = rc * c - rs * s;
+			rs = rc * s + rs * c;
+			rc = t;
+		}
+		float t = c * c - s * s;
+		s = 2.0f * c * s;
+		c = t;
+		n >>= 1;
+	}
+	c = rc;
+	s = rs;
+}
+
+static float powInt(float x, int n)
+{
+	float r = 1.0f;
+	while (n > 0)
+	{
+		if (n & 1) r *= x;
+		x *= x;
+		n >>= 1;
+	}
+	return r;
+}
+
+// z -> z^power + p in spherical coordinates, theta from +y and phi in xz.
+// For an integer power n, cos/sin of n*theta and n*phi are the real and
+// imaginary parts of (cos + i sin)^n, and cos/sin themselves are just ratios
+// of z's components, so no trig is needed
+float mandelbulbDE(Vector3 pt, float iterations, float scale, float power, bool trig)
+{
+	Vector3 p = pt / scale;
+	float radius = scale * 2.0f;
+	bool integer = !trig && mandelbulbIntegerPower(power);
+	int n = (int)power;
+
+	Vector3 z = p;
+	float dr = 1.0f;
+	float r = 0.0f;
+
+	for (int i = 0; i < iterations; i++)
+	{
+		r = Vector3Length(z);
+		if (r > radius)
+		{
+			break;
+		}
+
+		Vector3 dir;
+		float rPow;		// r^(power - 1)
+
+		if (integer)
+		{
+			float rho = sqrtf(z.x * z.x + z.z * z.z);
+			float ct = z.y / fmaxf(r, 1e-20f), st = rho / fmaxf(r, 1e-20f);
+			float cp = z.x / fmaxf(rho, 1e-20f), sp = z.z / fmaxf(rho, 1e-20f);
+			complexPow(ct, st, n);
+			complexPow(cp, sp, n);
+
+			dir = { st * cp, ct, sp * st };
+			rPow = powInt(r, n - 1);
+		}
+		else
+		{
+			float theta = acosf(z.y / r) * power;
+			float phi = atan2f(z.z, z.x) * power;
+
+			dir = { sinf(theta) * cosf(phi), cosf(theta), sinf(phi) * sinf(theta) };
+			rPow = powf(r, power - 1.0f);
+		}
+
+		dr = rPow * power * dr + 1.0f;
+		z = dir * (rPow * r) + p;
+	}
+
+	return (0.5f * logf(r) * r / dr) * scale;
+}
+
+// the shader offsets points by +origin, so CPU shapes sit at -origin to match it
+int buildShapes(int types[], Vector3 origins[], Vector3 sizes[], Vector3 cols[], int count, vector<Shape*>& out)
+{
+	for (int i = 0; i < count; i++)
+	{
+		Vector3 origin = Vector3Negate(origins[i]);
+		Shape* s = nullptr;
+
+		switch (types[i])
+		{
+			case SHAPE_TYPE_SPHERE:
+				s = new Sphere(origin, sizes[i].x);
+				break;
+			case SHAPE_TYPE_BOX:
+				s = new Box(origin, sizes[i]);
+				break;
+			case SHAPE_TYPE_TORUS:
+				s = new Torus(origin, { sizes[i].x, sizes[i].y });
+				break;
+			case SHAPE_TYPE_MANDELBULB:
+				s = new Mandelbulb(origin, sizes[i]);
+				break;
+			default:
+				cout << "CPU: shape type " << types[i] << " not supported, skipping" << endl;
+				break;
+		}
+
+		if (s)
+		{
+			s->col = cols[i];
+			out.push_back(s);
+		}
+	}
+	return (int)out.size();
+}
+
+void freeShapes(vector<Shape*>& shapes)
+{
+	for (int i = 0; i < shapes.size(); i++)
+	{
+		delete shapes[i];
+	}
+	shapes.clear();
+}
+
+int closestShape(Shape* shapes[], Vector3 pt, int length)
+{
+	int closest = 0;
+	float best = shapes[0]->sdf(pt);
+
+	for (int idx = 1; idx < length; idx++)
+	{
+		float d = shapes[idx]->sdf(pt);
+		if (d < best)
+		{
+			best = d;
+			closest = idx;
+		}
+	}
+	return closest;
+}
+
+// smin() can pull the surface out to k*log2(n) beyond the nearest shape
+BoundingBox sceneBounds(Shape* shapes[], int length, float k)
+{
+	BoundingBox box = shapes[0]->bounds();
+	for (int idx = 1; idx < length; idx++)
+	{
+		BoundingBox b = shapes[idx]->bounds();
+		box.min = Vector3Min(box.min, b.min);
+		box.max = Vector3Max(box.max, b.max);
+	}
+
+	float grow = (k <= 0.05f) ? 0.0f : k * log2f((float)max(length, 2));
+	Vector3 pad = { grow, grow, grow };
+	return { box.min - pad, box.max + pad };
+}
@@ -0,0 +1,532 @@
+#ifndef ENGINE_HPP
+#define ENGINE_HPP
+
+#include "raylib.h"
+#include "raymath.h"
+#include "raybuffer.hpp"
+#include "scenestore.hpp"
+#include "bvh.hpp"
+#include "brickmap.hpp"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// CPU ray marching engine (shapes, rays, camera)
+
+constexpr int screenX = 800;
+constexpr int screenY = 600;
+
+extern float k;			// smoothness, defined in raymarcher3d.cpp
+
+// same codes as raymarcher3d.fs
+constexpr int SHAPE_TYPE_SPHERE = 0;
+constexpr int SHAPE_TYPE_BOX = 1;
+constexpr int SHAPE_TYPE_TORUS = 2;
+constexpr int SHAPE_TYPE_MANDELBULB = 3;
+
+// smooth union variants for the CPU path, see sminBlend()
+enum SminMode
+{
+	SMIN_EXPONENTIAL,	// -k * log2(2^(-a/k) + 2^(-b/k)), the original CPU smin()
+	SMIN_POLYNOMIAL,	// quadratic, same as raymarcher3d.fs
+	SMIN_CUBIC,
+	SMIN_HARD
+};
+
+extern SminMode sminMode;	// CPU smooth union, defined in raymarcher3d.cpp
+
+class Shape;
+class RayMarch;
+
+// Function declarations
+Vector2 oneDtoTwoD(int, int);
+Vector3 absVec(Vector3);
+float SdfMinOfAll(Shape*[], Vector3, int, float);
+float smin(float, float, float);
+
+// (distance, blend towards b) like the shader's smin(); returns the hard min
+// without blending once |a - b| reaches sminRadius()
+Vector2 sminBlend(float, float, float, SminMode);
+float sminRadius(float, SminMode);
+Vector4 combine(float, float, Vector3, Vector3, float, SminMode);	// (colour, distance) like the shader's combine()
+float SdfMinOfAll(Shape*[], Vector3, int, float, SminMode);
+Vector4 SdfColorOfAll(Shape*[], Vector3, int, float, SminMode);		// blended colour and distance, like sceneSDF()
+bool parseSminMode(const char*, SminMode&);
+const char* sminName(SminMode);
+float min(float, float);
+
+// build CPU shapes from the shader's shape arrays (unsupported types are skipped)
+int buildShapes(int[], Vector3[], Vector3[], Vector3[], int, std::vector<Shape*>&);
+void freeShapes(std::vector<Shape*>&);
+int closestShape(Shape*[], Vector3, int);	// index of the shape nearest to a point
+BoundingBox sceneBounds(Shape*[], int, float);	// box containing the smooth union of all shapes
+
+// raymarcher3d.fs sdfMandelbulb, point relative to the centre; integer powers
+// skip acos/atan/sin/cos/pow unless trig is set
+float mandelbulbDE(Vector3, float iterations, float scale, float power, bool trig = false);
+bool mandelbulbIntegerPower(float);
+
+// running smin over any number of distances, equal to chaining smin() but
+// kept relative to the current minimum so exp2 can't underflow far away.
+// weight counts one value for several shapes (used for culled BVH nodes)
+struct SminAccumulator
+{
+	float k;
+	float m = 1e30f;	// smallest distance so far
+	float s = 0.0f;		// sum of 2^((m - d) / k)
+
+	void add(float d, float weight = 1.0f)
+	{
+		if (k <= 0.05f)
+		{
+			if (d < m) m = d;
+		}
+		else if (d < m)
+		{
+			s = s * exp2f((d - m) / k) + weight;
+			m = d;
+		}
+		else
+		{
+			s += weight * exp2f((m - d) / k);
+		}
+	}
+
+	float result() const
+	{
+		if (k <= 0.05f) return m;
+		return m - k * log2f(s);
+	}
+};
+
+class Shape
+{
+public:
+	int type = -1;
+	Vector3 origin;
+	Vector3 col = { 1.0f, 1.0f, 1.0f };
+
+	virtual ~Shape() {}
+
+	virtual float sdf(Vector3 pt)
+	{
+		return 6.7f;
+	}
+
+	// axis-aligned box containing the shape
+	virtual BoundingBox bounds()
+	{
+		return { { -1e6f, -1e6f, -1e6f }, { 1e6f, 1e6f, 1e6f } };
+	}
+};
+
+class Sphere : public Shape
+{
+public:
+	float radius;
+
+	Sphere(Vector3 origin, float radius)
+	{
+		type = SHAPE_TYPE_SPHERE;
+		this->origin = origin;
+		this->radius = radius;
+	}
+
+	float sdf(Vector3 pt) override
+	{
+		Vector3 newPt = pt - origin;
+		return Vector3Length(newPt) - radius;
+	}
+
+	BoundingBox bounds() override
+	{
+		Vector3 r = { radius, radius, radius };
+		return { origin - r, origin + r };
+	}
+};
+class Box : public Shape
+{
+public:
+	Vector3 lengths;
+
+	Box(Vector3 origin, Vector3 lengths)
+	{
+		type = SHAPE_TYPE_BOX;
+		this->lengths = lengths;
+		this->origin = origin;
+	}
+
+	float sdf(Vector3 pt) override
+	{
+		Vector3 newPt = pt - origin;
+
+		Vector3 q = absVec(newPt) - lengths;
+		return Vector3Length(Vector3Max(q, Vector3Zero())) +
+			min(std::max(q.x, std::max(q.y, q.z)), 0.0f);
+	}
+
+	BoundingBox bounds() override
+	{
+		return { origin - lengths, origin + lengths };
+	}
+};
+class Torus : public Shape
+{
+public:
+	Vector2 torusValues = { 1.0, 1.0 };
+
+	Torus(Vector3 origin, Vector2 values)
+	{
+		type = SHAPE_TYPE_TORUS;
+		this->origin = origin;
+		torusValues = values;
+	}
+
+	float sdf(Vector3 pt) override
+	{
+		Vector3 newPt = pt - origin;
+
+		Vector2 q = { Vector2Length({newPt.x, newPt.z}) - torusValues.x, newPt.y };
+		return Vector2Length(q) - torusValues.y;
+	}
+
+	BoundingBox bounds() override
+	{
+		float outer = torusValues.x + torusValues.y;
+		Vector3 r = { outer, torusValues.y, outer };
+		return { origin - r, origin + r };
+	}
+};
+
+class Mandelbulb : public Shape
+{
+public:
+	// same layout as the shader's shapeSizes
+	float iterations;
+	float scale;
+	float power;
+
+	Mandelbulb(Vector3 origin, Vector3 values)
+	{
+		type = SHAPE_TYPE_MANDELBULB;
+		this->origin = origin;
+		iterations = values.x;
+		scale = values.y;
+		power = values.z;
+	}
+
+	float sdf(Vector3 pt) override
+	{
+		return mandelbulbDE(pt - origin, iterations, scale, power);
+	}
+
+	// the shader's escape radius
+	BoundingBox bounds() override
+	{
+		Vector3 r = { 2.0f * scale, 2.0f * scale, 2.0f * scale };
+		return { origin - r, origin + r };
+	}
+};
+
+class RayMarch
+{
+public:
+	Vector2 pixel;
+	Vector3 origin;
+	Vector3 dir;
+	float totalDistance = 0.0f;
+	int stepsTaken = 0.0f;
+
+	RayMarch()
+	{
+
+	}
+
+	RayMarch(Vector3 origin, Vector3 offset)
+	{
+		this->origin = origin;
+		dir = offset;
+	}
+
+	void march(float length, Vector3 dir)
+	{
+		origin += dir * length;
+		totalDistance += length;
+		stepsTaken++;
+	}
+};
+
+class Cam3d
+{
+public:
+	Vector3 origin = { 0.0f, 0.0f, 0.0f };
+	Vector3 dir = { 0, 0, -1 };
+	Vector2 rotation = { 0, 0 };
+
+	float moveSpeed = 0.1;
+	float rotSpeed = 0.02;
+
+	float fov;
+
+	Vector3 worldUp()
+	{
+		if (fabs(Vector3DotProduct(forward(), { 0.0f, 1.0f, 0.0f })) > 0.999f)
+		{
+			return { 1.0f, 0.0f, 0.0f };
+		}
+		return { 0.0f, 1.0f, 0.0f };
+	}
+
+	Vector3 forward()
+	{
+		return Vector3Normalize(dir);
+	}
+	Vector3 right()
+	{
+		return Vector3Normalize(Vector3CrossProduct(worldUp(), forward()));
+	}
+	Vector3 up()
+	{
+		return Vector3CrossProduct(forward(), right());
+	}
+
+	void rotate(bool isYaw, float amount)
+	{
+		amount *= rotSpeed;
+		if (isYaw)
+		{
+			dir = Vector3RotateByAxisAngle(dir, { 0.0, 1.0, 0.0 }, amount);
+		}
+		else
+		{
+			dir = Vector3RotateByAxisAngle(dir, right(), amount);
+
+			if (dir.y > 1.0f) dir.y = 1.0f;
+			if (dir.y < -1.0f) dir.y = -1.0f;
+
+		}
+
+		dir = Vector3Normalize(dir);
+	}
+	void move(Vector3 d)
+	{
+		Vector3 dir = Vector3Zero();
+		std::cout << dir.x << " " << dir.z << std::endl;
+		dir = Vector3Add(Vector3Scale(right(), d.x), dir);
+		dir = Vector3Add(Vector3Scale(forward(), -d.z), dir);
+		dir.y += d.y;
+
+		std::cout << dir.x << " " << dir.z << std::endl;
+
+		origin += dir * moveSpeed;
+	}
+
+	float clipEnd = 100.0f;
+	float hitThreshold = 0.001f;
+	float relaxation = 1.0f;	// sphere tracing over-relaxation, 1 = plain, < 2
+	bool adaptiveThreshold = false;	// grow the hit threshold with the pixel footprint
+	float pixelCone = 0.0f;		// footprint radius per unit distance, set by initRays
+
+	// hit epsilon at distance t along a ray
+	float hitEpsilon(float t) const
+	{
+		return adaptiveThreshold ? fmaxf(hitThreshold, t * pixelCone) : hitThreshold;
+	}
+
+	RayBuffer rays;		// sized to the render resolution, reused across frames
+
+	Cam3d()
+	{
+		dir = { 0.0f, 0.0f, -1.0f };
+		fov = PI/2.5;
+	}
+
+	void initRays(int width = screenX, int height = screenY)
+	{
+		rays.resize(width, height);
+
+		// FOV stuff
+		float aspect = (float)width / (float)height;
+		float halfHeight = tanf(fov / 2.0f);
+		float halfWidth = aspect * halfHeight;
+
+		// a pixel spans 2 * halfHeight / height per unit distance, half that is its radius
+		pixelCone = halfHeight / height;
+
+		Vector3 f = forward();
+		Vector3 r = right();
+		Vector3 u = up();
+
+		for (int idx = 0; idx < rays.count; idx++)
+		{
+			Vector2 pixel = oneDtoTwoD(idx, width);
+
+			float u01 = (pixel.x + 0.5f) / width;
+			float v01 = (pixel.y + 0.5f) / height;
+
+			float x = (2.0f * u01 - 1.0f) * halfWidth;
+			float y = (1.0f - 2.0f * v01) * halfHeight;
+
+			Vector3 dir = Vector3Normalize(
+				Vector3Add(Vector3Add(f, Vector3Scale(r, x)), Vector3Scale(u, y))
+			);
+
+			rays.setRay(idx, origin, dir);
+		}
+	}
+
+	// march ray idx of the ray buffer with any callable scene sdf(Vector3),
+	// 0 = hit, 1 = no hit
+	template <typename Sdf>
+	int marchRayWith(int idx, const Sdf& sdf)
+	{
+		if (relaxation > 1.0f)
+		{
+			return marchRayRelaxed(idx, sdf);
+		}
+
+		Vector3 o = rays.origin(idx);
+		Vector3 d = rays.dir(idx);
+		float t = rays.t[idx];
+		float start = t;		// > 0 when seeded from the last frame
+		int steps = rays.steps[idx];
+		int evals = rays.evals[idx];
+
+		float length = hitThreshold;
+		while (t < clipEnd && length >= hitEpsilon(t))
+		{
+			length = sdf(o + d * t);
+			evals++;
+			if (length < 0.0f)
+			{
+				// a seed inside geometry is no good, march from the camera instead
+				if (start > 0.0f && t == start)
+				{
+					t = start = 0.0f;
+					length = hitThreshold;
+					continue;
+				}
+				break;
+			}
+			t += length;
+			steps++;
+		}
+
+		rays.t[idx] = t;
+		rays.steps[idx] = steps;
+		rays.evals[idx] = evals;
+
+		return (t > clipEnd) ? 1 : 0;
+	}
+
+	// over-relaxed sphere tracing (Keinert et al. 2014): step relaxation * d.
+	// If the unbounding spheres of this sample and the last one don't overlap
+	// the step skipped past a surface, so go back and step normally from then on
+	template <typename Sdf>
+	int marchRayRelaxed(int idx, const Sdf& sdf)
+	{
+		Vector3 o = rays.origin(idx);
+		Vector3 d = rays.dir(idx);
+		float t = rays.t[idx];
+		float start = t;
+		int steps = rays.steps[idx];
+		int evals = rays.evals[idx];
+
+		float omega = relaxation;
+		float prevT = t;
+		float prevLength = 0.0f;
+
+		while (t < clipEnd)
+		{
+			float length = sdf(o + d * t);
+			steps++;
+			evals++;
+
+			if (length < 0.0f && start > 0.0f && t == start)
+			{
+				t = start = prevT = 0.0f;
+				continue;
+			}
+
+			if (omega > 1.0f && (length < 0.0f || length + prevLength < t - prevT))
+			{
+				t = prevT + prevLength;
+				omega = 1.0f;
+				continue;
+			}
+			if (length < hitEpsilon(t))
+			{
+				break;
+			}
+
+			prevT = t;
+			prevLength = length;
+			t += length * omega;
+		}
+
+		rays.t[idx] = t;
+		rays.steps[idx] = steps;
+		rays.evals[idx] = evals;
+
+		return (t > clipEnd) ? 1 : 0;
+	}
+
+	int marchRay(int idx, Shape* shapes[], int size)
+	{
+		return marchRayWith(idx, [&](Vector3 p) { return SdfMinOfAll(shapes, p, size, k, sminMode); });
+	}
+
+	int marchRay(int idx, const SceneStore& scene)
+	{
+		return marchRayWith(idx, [&](Vector3 p) { return scene.sdf(p, k); });
+	}
+
+	int marchRay(int idx, const ShapeBVH& bvh)
+	{
+		return marchRayWith(idx, [&](Vector3 p) { return bvh.sdf(p, k); });
+	}
+
+	int marchRay(int idx, const BrickMap& baked)
+	{
+		return marchRayWith(idx, [&](Vector3 p) { return baked.sdf(p); });
+	}
+
+	int marchRay(RayMarch& r, Shape* shapes[], int size, bool printData)
+	{
+		float length = hitThreshold;
+		while (r.totalDistance < clipEnd && length >= hitThreshold)
+		{
+			if (printData)
+			{
+				std::cout << "MARCHING! ";
+			}
+			length = SdfMinOfAll(shapes, r.origin, size, k);
+			if (length < 0.0f)
+			{
+				return 0;
+			}
+			r.march(length, r.dir);
+
+		}
+		//cout << "ENDLOOP!";
+
+		if (r.totalDistance > clipEnd)
+		{
+			return 1; // RAY HIT DEAD AIR!
+			std::cout << std::endl << "NO HIT!";
+		}
+		else
+		{
+			return 0; // RAY HIT OBJECT!
+			std::cout << std::endl << "HIT!";
+		}
+	}
+
+
+	float verticalFOV()
+	{
+		return (fov / screenX) * screenY;
+	}
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef GLPROC_HPP
+#define GLPROC_HPP
+
+// GL entry points rlgl doesn't wrap. raylib's desktop build links GLFW, so
+// they come from its loader once the window (and GL context) exists
+
+#ifdef _WIN32
+#define GL_CALL __stdcall
+#else
+#define GL_CALL
+#endif
+
+typedef void (*GLProc)(void);
+extern "C" GLProc glfwGetProcAddress(const char* name);
+
+#endif
@@ -0,0 +1,47 @@
+#include "cpurender.hpp"
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// Standalone headless renderer: --headless from the app without the window,
+// GPU or ImGui, for render nodes with no display. Renders the app's startup
+// scene; see "Headless CPU rendering" in the README.
+
+float k = 1.0f;
+SminMode sminMode = SMIN_EXPONENTIAL;
+
+int main(int argc, char* argv[])
+{
+	// as the app's startup scene and lighting
+	vector<int> shapeTypes = { 1, 0 };
+	vector<Vector3> shapePositions = {
+		{-2.0f, 3.5f, -1.0f},
+		{0.0f, 0.0f, 0.0f}
+	};
+	vector<Vector3> shapeSizes = {
+		{1.5f, 1.5f, 1.5f},
+		{1.0f, 1.0f, 1.0f}
+	};
+	vector<Vector3> shapeCols = {
+		{0.8f, 0.2f, 0.2f},
+		{0.8f, 0.9f, 0.1f}
+	};
+	Vector3 lightPos = { 5.0f, -6.0f, 5.0f };
+	Vector3 lightCol = { 1.0f, 1.0f, 1.0f };
+	Vector3 bgColor = { 0.1f, 0.1f, 0.2f };
+
+	Cam3d cam = Cam3d();
+	cam.origin = { 0.0f, 0.0f, 5.0f };
+
+	// --headless is implied here
+	HeadlessOptions opt;
+	parseHeadlessArgs(argc, argv, opt);
+
+	vector<Shape*> shapes;
+	int count = buildShapes(shapeTypes.data(), shapePositions.data(), shapeSizes.data(), shapeCols.data(), (int)shapeTypes.size(), shapes);
+
+	int result = runHeadless(opt, cam, shapes.data(), count, { lightPos, lightCol, bgColor });
+	freeShapes(shapes);
+	return result;
+}
@@ -0,0 +1,84 @@
+#include "heatmap.hpp"
+#include <cstdio>
+#include <cstring>
+#include <math.h>
+
+using namespace std;
+
+bool parseHeatmapMode(const char* name, HeatmapMode& mode)
+{
+	if (strcmp(name, "off") == 0) mode = HEATMAP_OFF;
+	else if (strcmp(name, "steps") == 0) mode = HEATMAP_STEPS;
+	else if (strcmp(name, "evals") == 0) mode = HEATMAP_EVALS;
+	else return false;
+	return true;
+}
+
+const char* heatmapName(HeatmapMode mode)
+{
+	switch (mode)
+	{
+		case HEATMAP_STEPS: return "steps";
+		case HEATMAP_EVALS: return "evals";
+		default: return "off";
+	}
+}
+
+static float saturate(float f)
+{
+	return fminf(fmaxf(f, 0.0f), 1.0f);
+}
+
+Vector3 heatColor(float t)
+{
+	t = saturate(t);
+	return {
+		saturate(1.5f - fabsf(4.0f * t - 3.0f)),
+		saturate(1.5f - fabsf(4.0f * t - 2.0f)),
+		saturate(1.5f - fabsf(4.0f * t - 1.0f))
+	};
+}
+
+int maxCount(const int* counts, int count)
+{
+	int best = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (counts[i] > best) best = counts[i];
+	}
+	return best;
+}
+
+void overlayHeatmap(vector<Color>& pixels, const int* counts, int maxValue, float blend)
+{
+	float scale = (maxValue > 0) ? 1.0f / maxValue : 0.0f;
+
+	for (int i = 0; i < pixels.size(); i++)
+	{
+		Vector3 heat = heatColor(counts[i] * scale);
+		Color& c = pixels[i];
+		c.r = (unsigned char)(c.r + (heat.x * 255.0f - c.r) * blend + 0.5f);
+		c.g = (unsigned char)(c.g + (heat.y * 255.0f - c.g) * blend + 0.5f);
+		c.b = (unsigned char)(c.b + (heat.z * 255.0f - c.b) * blend + 0.5f);
+	}
+}
+
+bool writeCounts(const int* counts, int width, int height, const string& path)
+{
+	FILE* f = fopen(path.c_str(), "wb");
+	if (!f)
+	{
+		return false;
+	}
+
+	// 16-bit PGM samples are big-endian
+	fprintf(f, "P5\n%d %d\n65535\n", width, height);
+	for (int i = 0; i < width * height; i++)
+	{
+		int v = counts[i] < 0 ? 0 : (counts[i] > 65535 ? 65535 : counts[i]);
+		unsigned char be[2] = { (unsigned char)(v >> 8), (unsigned char)(v & 0xff) };
+		fwrite(be, 1, 2, f);
+	}
+	fclose(f);
+	return true;
+}
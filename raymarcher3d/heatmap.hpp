@@ -0,0 +1,28 @@
+#ifndef HEATMAP_HPP
+#define HEATMAP_HPP
+
+#include "raylib.h"
+#include <string>
+#include <vector>
+
+// Per-pixel cost view: march steps or scene SDF evaluations (march, normals,
+// shadow, AO) for each pixel, drawn as a false-colour ramp over the image,
+// blue = free, red = the chosen maximum or more. raymarcher3d.fs has the
+// same ramp in heatColor().
+
+enum HeatmapMode
+{
+	HEATMAP_OFF,
+	HEATMAP_STEPS,
+	HEATMAP_EVALS
+};
+
+// Function declarations
+bool parseHeatmapMode(const char*, HeatmapMode&);	// "off", "steps", "evals"
+const char* heatmapName(HeatmapMode);
+Vector3 heatColor(float);							// 0..1 -> blue..red
+int maxCount(const int*, int);
+void overlayHeatmap(std::vector<Color>&, const int* counts, int maxValue, float blend);
+bool writeCounts(const int*, int, int, const std::string&);	// raw counts as a 16-bit PGM, clamped to 65535
+
+#endif
@@ -0,0 +1,251 @@
+#include "profiler.hpp"
+#include "glproc.hpp"
+#include "rlgl.h"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <float.h>
+
+#include <imgui/imgui.h>
+
+using namespace std;
+
+// rlgl has no query objects
+typedef void (GL_CALL *GenQueriesFn)(int, unsigned int*);
+typedef void (GL_CALL *DeleteQueriesFn)(int, const unsigned int*);
+typedef void (GL_CALL *QueryCounterFn)(unsigned int, unsigned int);
+typedef void (GL_CALL *GetQueryObjectivFn)(unsigned int, unsigned int, int*);
+typedef void (GL_CALL *GetQueryObjectui64vFn)(unsigned int, unsigned int, unsigned long long*);
+typedef void (GL_CALL *GetInteger64vFn)(unsigned int, long long*);
+
+static const unsigned int QUERY_TIMESTAMP = 0x8E28;			// GL_TIMESTAMP
+static const unsigned int QUERY_RESULT = 0x8866;			// GL_QUERY_RESULT
+static const unsigned int QUERY_RESULT_AVAILABLE = 0x8867;	// GL_QUERY_RESULT_AVAILABLE
+
+static GenQueriesFn genQueries;
+static DeleteQueriesFn deleteQueries;
+static QueryCounterFn queryCounter;
+static GetQueryObjectivFn getQueryObjectiv;
+static GetQueryObjectui64vFn getQueryObjectui64v;
+static GetInteger64vFn getInteger64v;
+
+const char* stageName(FrameStage stage)
+{
+	switch (stage)
+	{
+		case STAGE_INPUT: return "Input";
+		case STAGE_UNIFORMS: return "Uniforms";
+		case STAGE_SCENE: return "Scene";
+		case STAGE_AA: return "AA";
+		case STAGE_IMGUI: return "ImGui";
+		case STAGE_PRESENT: return "Present";
+		default: return "?";
+	}
+}
+
+void StageHistory::push(float ms)
+{
+	samples[head] = ms;
+	head = (head + 1) % HISTORY;
+	if (count < HISTORY) count++;
+}
+
+float StageHistory::last() const
+{
+	return count ? samples[(head + HISTORY - 1) % HISTORY] : 0.0f;
+}
+
+float StageHistory::percentile(float p) const
+{
+	if (count == 0) return 0.0f;
+
+	// the stored samples are the first count slots until the ring wraps
+	float sorted[HISTORY];
+	copy(samples, samples + count, sorted);
+
+	int n = (int)(p / 100.0f * (count - 1) + 0.5f);
+	nth_element(sorted, sorted + n, sorted + count);
+	return sorted[n];
+}
+
+void FrameProfiler::init()
+{
+	genQueries = (GenQueriesFn)glfwGetProcAddress("glGenQueries");
+	deleteQueries = (DeleteQueriesFn)glfwGetProcAddress("glDeleteQueries");
+	queryCounter = (QueryCounterFn)glfwGetProcAddress("glQueryCounter");
+	getQueryObjectiv = (GetQueryObjectivFn)glfwGetProcAddress("glGetQueryObjectiv");
+	getQueryObjectui64v = (GetQueryObjectui64vFn)glfwGetProcAddress("glGetQueryObjectui64v");
+	getInteger64v = (GetInteger64vFn)glfwGetProcAddress("glGetInteger64v");
+
+	gpuTimers = genQueries && deleteQueries && queryCounter && getQueryObjectiv && getQueryObjectui64v && getInteger64v;
+	if (gpuTimers)
+	{
+		genQueries(GPU_LATENCY * STAGE_COUNT * 2, &queries[0][0][0]);
+	}
+}
+
+void FrameProfiler::shutdown()
+{
+	if (gpuTimers)
+	{
+		deleteQueries(GPU_LATENCY * STAGE_COUNT * 2, &queries[0][0][0]);
+		gpuTimers = false;
+	}
+}
+
+// GPU timestamps count from an arbitrary origin: line the current one up
+// with the CPU clock once per capture
+void FrameProfiler::calibrateGpuClock()
+{
+	long long gpuNow = 0;
+	getInteger64v(QUERY_TIMESTAMP, &gpuNow);
+	gpuOffsetUs = trace->toUs(Clock::now()) - gpuNow / 1000.0;
+}
+
+void FrameProfiler::beginFrame()
+{
+	if (!enabled) return;
+	frameStart = Clock::now();
+
+	bool capturing = trace && trace->capturing;
+	if (capturing && !wasCapturing && gpuTimers) calibrateGpuClock();
+	wasCapturing = capturing;
+}
+
+void FrameProfiler::begin(FrameStage stage)
+{
+	if (!enabled) return;
+
+	if (gpuTimers)
+	{
+		// queued raylib draws belong to whoever queued them
+		rlDrawRenderBatchActive();
+		queryCounter(queries[frame % GPU_LATENCY][stage][0], QUERY_TIMESTAMP);
+	}
+	stageStart[stage] = Clock::now();
+}
+
+void FrameProfiler::end(FrameStage stage)
+{
+	if (!enabled) return;
+
+	if (gpuTimers)
+	{
+		rlDrawRenderBatchActive();
+		queryCounter(queries[frame % GPU_LATENCY][stage][1], QUERY_TIMESTAMP);
+		issued[frame % GPU_LATENCY][stage] = true;
+		if (stage == STAGE_SCENE)
+		{
+			issuedVariant[frame % GPU_LATENCY] = sceneVariant;
+			issuedFeatures[frame % GPU_LATENCY] = sceneFeatures;
+		}
+	}
+	Clock::time_point now = Clock::now();
+	cpu[stage].push(chrono::duration<float, milli>(now - stageStart[stage]).count());
+	if (trace) trace->record(stageName(stage), "stage", TRACE_TID_MAIN, stageStart[stage], now);
+}
+
+void FrameProfiler::endFrame()
+{
+	if (!enabled) return;
+
+	Clock::time_point now = Clock::now();
+	frameCpu.push(chrono::duration<float, milli>(now - frameStart).count());
+	if (trace) trace->record("Frame", "frame", TRACE_TID_MAIN, frameStart, now);
+
+	// the oldest slot is reused next frame: take what has landed, drop the rest
+	if (gpuTimers)
+	{
+		int slot = (frame + 1) % GPU_LATENCY;
+		for (int s = 0; s < STAGE_COUNT; s++)
+		{
+			if (!issued[slot][s]) continue;
+			issued[slot][s] = false;
+
+			int available = 0;
+			getQueryObjectiv(queries[slot][s][1], QUERY_RESULT_AVAILABLE, &available);
+			if (!available) continue;
+
+			unsigned long long t0 = 0, t1 = 0;
+			getQueryObjectui64v(queries[slot][s][0], QUERY_RESULT, &t0);
+			getQueryObjectui64v(queries[slot][s][1], QUERY_RESULT, &t1);
+			gpu[s].push((float)((t1 - t0) / 1e6));
+			if (s == STAGE_SCENE && issuedVariant[slot] >= 0)
+			{
+				if (issuedFeatures[slot] != comparedFeatures)
+				{
+					for (int v = 0; v < SCENE_VARIANTS; v++) sceneGpu[v].clear();
+					comparedFeatures = issuedFeatures[slot];
+				}
+				sceneGpu[issuedVariant[slot]].push((float)((t1 - t0) / 1e6));
+			}
+			if (trace) trace->record(stageName((FrameStage)s), "gpu", TRACE_TID_GPU, t0 / 1000.0 + gpuOffsetUs, (t1 - t0) / 1000.0);
+		}
+	}
+	frame++;
+}
+
+void drawProfilerPanel(const FrameProfiler& profiler, float x, float y)
+{
+	static const ImU32 stageCols[STAGE_COUNT] = {
+		IM_COL32(90, 160, 230, 255), IM_COL32(120, 200, 120, 255), IM_COL32(230, 120, 70, 255),
+		IM_COL32(220, 200, 80, 255), IM_COL32(170, 120, 220, 255), IM_COL32(140, 140, 140, 255)
+	};
+
+	ImGui::SetNextWindowPos(ImVec2(x, y), ImGuiCond_FirstUseEver);
+	ImGui::SetNextWindowBgAlpha(0.75f);
+
+	if (ImGui::Begin("Profiler"))
+	{
+		// last frame as a CPU timeline, stages left to right
+		const StageHistory& frame = profiler.frameCpu;
+		float total = frame.last();
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		float width = ImGui::GetContentRegionAvail().x;
+		float cursor = origin.x;
+		ImDrawList* draw = ImGui::GetWindowDrawList();
+
+		for (int s = 0; s < STAGE_COUNT; s++)
+		{
+			float w = (total > 0.0f) ? profiler.cpu[s].last() / total * width : 0.0f;
+			draw->AddRectFilled(ImVec2(cursor, origin.y), ImVec2(cursor + w, origin.y + 14.0f), stageCols[s]);
+			cursor += w;
+		}
+		ImGui::Dummy(ImVec2(width, 16.0f));
+
+		// frame time history, oldest first
+		float plot[StageHistory::HISTORY];
+		for (int i = 0; i < frame.count; i++)
+		{
+			plot[i] = frame.samples[(frame.head - frame.count + i + StageHistory::HISTORY) % StageHistory::HISTORY];
+		}
+		char overlay[32];
+		snprintf(overlay, sizeof(overlay), "%.2f ms", total);
+		ImGui::PlotLines("##frame", plot, frame.count, 0, overlay, 0.0f, FLT_MAX, ImVec2(width, 50.0f));
+
+		ImGui::Text("%-9s %-20s %-20s", "ms", "CPU p50 / p95 / p99", "GPU p50 / p95 / p99");
+		for (int s = 0; s < STAGE_COUNT; s++)
+		{
+			const StageHistory& c = profiler.cpu[s];
+			const StageHistory& g = profiler.gpu[s];
+			ImGui::TextColored(ImGui::ColorConvertU32ToFloat4(stageCols[s]), "%-9s", stageName((FrameStage)s));
+			ImGui::SameLine();
+			ImGui::Text("%5.2f %5.2f %5.2f   %5.2f %5.2f %5.2f", c.percentile(50), c.percentile(95), c.percentile(99),
+				g.percentile(50), g.percentile(95), g.percentile(99));
+		}
+		ImGui::Text("%-9s %5.2f %5.2f %5.2f", "Frame", frame.percentile(50), frame.percentile(95), frame.percentile(99));
+
+		// scene shader variants side by side, once both have drawn
+		const StageHistory* variants = profiler.sceneGpu;
+		if (variants[0].count && variants[1].count)
+		{
+			float a = variants[0].percentile(50);
+			float b = variants[1].percentile(50);
+			ImGui::Text("Scene GPU p50 (features 0x%02x): %s %.2f ms, %s %.2f ms (%+.0f%%)", profiler.comparedFeatures,
+				profiler.variantNames[0], a, profiler.variantNames[1], b, (a > 0.0f) ? (b - a) / a * 100.0f : 0.0f);
+		}
+
+		if (!profiler.gpuTimers) ImGui::TextUnformatted("GPU timer queries unavailable");
+	}
+	ImGui::End();
+}
@@ -0,0 +1,108 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <chrono>
+
+class TraceRecorder;
+
+// Frame stage profiler for the interactive app.
+//
+// Each stage of the main loop is timed on the CPU with steady_clock and on
+// the GPU with GL timestamp queries. Query results are read back
+// GPU_LATENCY frames later, once they are available, so the profiler never
+// waits on the GPU. The last HISTORY frames are kept per stage for the
+// p50/p95/p99 shown in the panel. Costs a few clock reads and, with GPU
+// timers, two queries and a batch flush per stage.
+
+enum FrameStage
+{
+	STAGE_INPUT,
+	STAGE_UNIFORMS,
+	STAGE_SCENE,		// ray march pass
+	STAGE_AA,			// antiAlias.fs pass
+	STAGE_IMGUI,		// building the UI
+	STAGE_PRESENT,		// final blit, ImGui draw, swap and frame pacing
+	STAGE_COUNT
+};
+
+// rolling window of samples in ms
+class StageHistory
+{
+public:
+	static const int HISTORY = 240;
+
+	float samples[HISTORY] = {};
+	int count = 0;
+	int head = 0;				// next write
+
+	void push(float ms);
+	void clear() { count = head = 0; }
+	float last() const;
+	float percentile(float p) const;		// 0..100, of what is stored
+};
+
+class FrameProfiler
+{
+public:
+	static const int GPU_LATENCY = 4;	// frames of queries in flight
+
+	bool enabled = true;
+	bool gpuTimers = false;			// GL timer queries loaded, set by init()
+	TraceRecorder* trace = nullptr;	// stages, frames and GPU passes recorded while it captures
+
+	StageHistory cpu[STAGE_COUNT];
+	StageHistory gpu[STAGE_COUNT];
+	StageHistory frameCpu;			// whole loop iteration
+
+	// STAGE_SCENE GPU time also kept apart by which variant of the scene
+	// shader drew it, to compare them in the panel. Only full frames at one
+	// feature set are compared; a new set starts both over
+	static const int SCENE_VARIANTS = 2;
+	int sceneVariant = 0;			// set before STAGE_SCENE ends, -1 if it didn't draw the whole frame
+	int sceneFeatures = 0;			// SceneFeature mask of the program that drew
+	const char* variantNames[SCENE_VARIANTS] = { "generic", "unrolled" };
+	StageHistory sceneGpu[SCENE_VARIANTS];
+	int comparedFeatures = -1;		// feature set sceneGpu holds
+
+	void init();					// after InitWindow, needs the GL context
+	void shutdown();
+
+	void beginFrame();
+	void endFrame();				// also collects finished GPU queries
+	void begin(FrameStage);
+	void end(FrameStage);
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::time_point frameStart;
+	Clock::time_point stageStart[STAGE_COUNT];
+
+	unsigned int queries[GPU_LATENCY][STAGE_COUNT][2] = {};	// begin / end timestamps
+	bool issued[GPU_LATENCY][STAGE_COUNT] = {};
+	int issuedVariant[GPU_LATENCY] = {};
+	int issuedFeatures[GPU_LATENCY] = {};
+	int frame = 0;
+
+	double gpuOffsetUs = 0.0;		// GPU timestamp -> trace timeline
+	bool wasCapturing = false;
+	void calibrateGpuClock();
+};
+
+// times the enclosing block as one stage
+class ProfileScope
+{
+public:
+	ProfileScope(FrameProfiler& profiler, FrameStage stage) : profiler(profiler), stage(stage) { profiler.begin(stage); }
+	~ProfileScope() { profiler.end(stage); }
+
+private:
+	FrameProfiler& profiler;
+	FrameStage stage;
+};
+
+// Function declarations
+const char* stageName(FrameStage);
+void drawProfilerPanel(const FrameProfiler&, float x, float y);	// ImGui window at (x, y)
+
+#endif
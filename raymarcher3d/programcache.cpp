@@ -0,0 +1,426 @@
+#include "programcache.hpp"
+#include "glproc.hpp"
+#include "rlgl.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#endif
+
+using namespace std;
+
+// rlgl links programs without the retrievable hint and has no binary calls
+typedef unsigned int (GL_CALL *CreateProgramFn)(void);
+typedef void (GL_CALL *DeleteProgramFn)(unsigned int);
+typedef void (GL_CALL *AttachShaderFn)(unsigned int, unsigned int);
+typedef void (GL_CALL *DetachShaderFn)(unsigned int, unsigned int);
+typedef void (GL_CALL *DeleteShaderFn)(unsigned int);
+typedef void (GL_CALL *BindAttribLocationFn)(unsigned int, unsigned int, const char*);
+typedef void (GL_CALL *ProgramParameteriFn)(unsigned int, unsigned int, int);
+typedef void (GL_CALL *LinkProgramFn)(unsigned int);
+typedef void (GL_CALL *GetProgramivFn)(unsigned int, unsigned int, int*);
+typedef void (GL_CALL *GetProgramInfoLogFn)(unsigned int, int, int*, char*);
+typedef void (GL_CALL *GetProgramBinaryFn)(unsigned int, int, int*, unsigned int*, void*);
+typedef void (GL_CALL *ProgramBinaryFn)(unsigned int, unsigned int, const void*, int);
+typedef void (GL_CALL *GetIntegervFn)(unsigned int, int*);
+typedef const unsigned char* (GL_CALL *GetStringFn)(unsigned int);
+
+static const unsigned int LINK_STATUS = 0x8B82;						// GL_LINK_STATUS
+static const unsigned int INFO_LOG_LENGTH = 0x8B84;					// GL_INFO_LOG_LENGTH
+static const unsigned int PROGRAM_BINARY_LENGTH = 0x8741;			// GL_PROGRAM_BINARY_LENGTH
+static const unsigned int PROGRAM_BINARY_RETRIEVABLE_HINT = 0x8257;	// GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+static const unsigned int NUM_PROGRAM_BINARY_FORMATS = 0x87FE;		// GL_NUM_PROGRAM_BINARY_FORMATS
+static const unsigned int VENDOR = 0x1F00;							// GL_VENDOR
+static const unsigned int RENDERER = 0x1F01;						// GL_RENDERER
+static const unsigned int VERSION = 0x1F02;							// GL_VERSION
+
+static CreateProgramFn createProgram;
+static DeleteProgramFn deleteProgram;
+static AttachShaderFn attachShader;
+static DetachShaderFn detachShader;
+static DeleteShaderFn deleteShader;
+static BindAttribLocationFn bindAttribLocation;
+static ProgramParameteriFn programParameteri;
+static LinkProgramFn linkProgram;
+static GetProgramivFn getProgramiv;
+static GetProgramInfoLogFn getProgramInfoLog;
+static GetProgramBinaryFn getProgramBinary;
+static ProgramBinaryFn programBinary;
+static GetIntegervFn getIntegerv;
+static GetStringFn getString;
+
+// raylib's default vertex shader for GL 3.3+
+static const char* DEFAULT_VS =
+	"#version 330\n"
+	"in vec3 vertexPosition;\n"
+	"in vec2 vertexTexCoord;\n"
+	"in vec4 vertexColor;\n"
+	"out vec2 fragTexCoord;\n"
+	"out vec4 fragColor;\n"
+	"uniform mat4 mvp;\n"
+	"void main()\n"
+	"{\n"
+	"    fragTexCoord = vertexTexCoord;\n"
+	"    fragColor = vertexColor;\n"
+	"    gl_Position = mvp*vec4(vertexPosition, 1.0);\n"
+	"}\n";
+
+static const char BINARY_MAGIC[4] = { 'R', 'M', 'P', 'B' };
+
+// file layout: header, driver string, program binary
+struct BinaryHeader
+{
+	char magic[4];
+	unsigned int format;
+	unsigned int length;
+	unsigned int driverLength;
+	unsigned long long key;
+};
+
+static unsigned long long hashBytes(unsigned long long hash, const char* bytes, size_t count)
+{
+	// FNV-1a
+	for (size_t i = 0; i < count; i++)
+	{
+		hash ^= (unsigned char)bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// a file in the cache directory, mtime is refreshed on every hit
+struct CacheFile
+{
+	string path;
+	long long bytes;
+	long long mtime;
+};
+
+static vector<CacheFile> listCacheFiles(const string& dir)
+{
+	vector<CacheFile> files;
+#ifdef _WIN32
+	_finddata_t data;
+	intptr_t handle = _findfirst((dir + "/*.bin").c_str(), &data);
+	if (handle == -1) return files;
+	do
+	{
+		files.push_back({ dir + "/" + data.name, (long long)data.size, (long long)data.time_write });
+	} while (_findnext(handle, &data) == 0);
+	_findclose(handle);
+#else
+	DIR* d = opendir(dir.c_str());
+	if (!d) return files;
+	while (dirent* e = readdir(d))
+	{
+		size_t n = strlen(e->d_name);
+		if (n < 4 || strcmp(e->d_name + n - 4, ".bin") != 0) continue;
+
+		string path = dir + "/" + e->d_name;
+		struct stat st;
+		if (stat(path.c_str(), &st) == 0) files.push_back({ path, (long long)st.st_size, (long long)st.st_mtime });
+	}
+	closedir(d);
+#endif
+	return files;
+}
+
+static void touchFile(const string& path)
+{
+#ifdef _WIN32
+	_utime(path.c_str(), nullptr);
+#else
+	utime(path.c_str(), nullptr);
+#endif
+}
+
+// header and driver string, enough to tell a file is for this driver
+static bool readDriver(const string& path, BinaryHeader& header, string& fileDriver)
+{
+	FILE* f = fopen(path.c_str(), "rb");
+	if (!f) return false;
+
+	bool ok = fread(&header, sizeof(header), 1, f) == 1 && memcmp(header.magic, BINARY_MAGIC, 4) == 0
+		&& header.driverLength < 4096;
+	fileDriver.assign(ok ? header.driverLength : 0, '\0');
+	ok = ok && fread(&fileDriver[0], 1, fileDriver.size(), f) == fileDriver.size();
+	fclose(f);
+	return ok;
+}
+
+static string glString(unsigned int name)
+{
+	const unsigned char* s = getString(name);
+	return s ? (const char*)s : "";
+}
+
+void ProgramCache::init()
+{
+	createProgram = (CreateProgramFn)glfwGetProcAddress("glCreateProgram");
+	deleteProgram = (DeleteProgramFn)glfwGetProcAddress("glDeleteProgram");
+	attachShader = (AttachShaderFn)glfwGetProcAddress("glAttachShader");
+	detachShader = (DetachShaderFn)glfwGetProcAddress("glDetachShader");
+	deleteShader = (DeleteShaderFn)glfwGetProcAddress("glDeleteShader");
+	bindAttribLocation = (BindAttribLocationFn)glfwGetProcAddress("glBindAttribLocation");
+	programParameteri = (ProgramParameteriFn)glfwGetProcAddress("glProgramParameteri");
+	linkProgram = (LinkProgramFn)glfwGetProcAddress("glLinkProgram");
+	getProgramiv = (GetProgramivFn)glfwGetProcAddress("glGetProgramiv");
+	getProgramInfoLog = (GetProgramInfoLogFn)glfwGetProcAddress("glGetProgramInfoLog");
+	getProgramBinary = (GetProgramBinaryFn)glfwGetProcAddress("glGetProgramBinary");
+	programBinary = (ProgramBinaryFn)glfwGetProcAddress("glProgramBinary");
+	getIntegerv = (GetIntegervFn)glfwGetProcAddress("glGetIntegerv");
+	getString = (GetStringFn)glfwGetProcAddress("glGetString");
+
+	int formats = 0;
+	if (getIntegerv) getIntegerv(NUM_PROGRAM_BINARY_FORMATS, &formats);
+	enabled = formats > 0 && programParameteri && getProgramBinary && programBinary && getString;
+
+	if (enabled)
+	{
+		driver = glString(VENDOR) + " | " + glString(RENDERER) + " | " + glString(VERSION);
+#ifdef _WIN32
+		_mkdir(dir.c_str());
+#else
+		mkdir(dir.c_str(), 0755);
+#endif
+		prune();
+	}
+}
+
+void ProgramCache::prune()
+{
+	vector<CacheFile> files = listCacheFiles(dir);
+
+	// another driver's binaries are never read again after an update
+	vector<CacheFile> kept;
+	long long bytes = 0;
+	for (const CacheFile& file : files)
+	{
+		BinaryHeader header;
+		string fileDriver;
+		if (!readDriver(file.path, header, fileDriver) || fileDriver != driver)
+		{
+			remove(file.path.c_str());
+			pruned++;
+			continue;
+		}
+		kept.push_back(file);
+		bytes += file.bytes;
+	}
+
+	// then least recently used first, down to the caps
+	sort(kept.begin(), kept.end(), [](const CacheFile& a, const CacheFile& b) { return a.mtime < b.mtime; });
+	int count = (int)kept.size();
+	for (const CacheFile& file : kept)
+	{
+		if (count <= maxFiles && bytes <= maxBytes) break;
+		remove(file.path.c_str());
+		pruned++;
+		count--;
+		bytes -= file.bytes;
+	}
+}
+
+string ProgramCache::path(unsigned long long key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", key);
+	return dir + "/" + name;
+}
+
+unsigned int ProgramCache::loadBinary(unsigned long long key)
+{
+	string file = path(key);
+	FILE* f = fopen(file.c_str(), "rb");
+	if (!f) return 0;
+
+	fseek(f, 0, SEEK_END);
+	long fileBytes = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	// the lengths must account for the file exactly, before anything is
+	// allocated from them
+	BinaryHeader header;
+	bool ok = fread(&header, sizeof(header), 1, f) == 1 && memcmp(header.magic, BINARY_MAGIC, 4) == 0
+		&& header.key == key && header.driverLength == driver.size()
+		&& (long long)sizeof(header) + header.driverLength + header.length == (long long)fileBytes;
+
+	// the key already covers the driver, this only guards against collisions
+	string fileDriver(ok ? header.driverLength : 0, '\0');
+	vector<char> binary(ok ? header.length : 0);
+	ok = ok && fread(&fileDriver[0], 1, fileDriver.size(), f) == fileDriver.size() && fileDriver == driver
+		&& fread(binary.data(), 1, binary.size(), f) == binary.size();
+	fclose(f);
+
+	// a rejected file would only be rejected again, the recompile rewrites it
+	if (!ok)
+	{
+		remove(file.c_str());
+		return 0;
+	}
+
+	unsigned int program = createProgram();
+	programBinary(program, header.format, binary.data(), (int)binary.size());
+
+	int linked = 0;
+	getProgramiv(program, LINK_STATUS, &linked);
+	if (!linked)
+	{
+		deleteProgram(program);
+		remove(file.c_str());
+		return 0;
+	}
+	touchFile(file);
+	return program;
+}
+
+void ProgramCache::saveBinary(unsigned long long key, unsigned int program)
+{
+	int length = 0;
+	getProgramiv(program, PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	BinaryHeader header;
+	memcpy(header.magic, BINARY_MAGIC, 4);
+	header.key = key;
+	header.driverLength = (unsigned int)driver.size();
+
+	vector<char> binary(length);
+	getProgramBinary(program, length, &length, &header.format, binary.data());
+	header.length = (unsigned int)length;
+
+	FILE* f = fopen(path(key).c_str(), "wb");
+	if (!f) return;
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(driver.data(), 1, driver.size(), f);
+	fwrite(binary.data(), 1, length, f);
+	fclose(f);
+}
+
+// compile and link as rlLoadShaderCode does, plus the retrievable hint
+static unsigned int linkFromSource(const char* vsCode, const char* fsCode, bool retrievable)
+{
+	unsigned int vs = rlCompileShader(vsCode, RL_VERTEX_SHADER);
+	unsigned int fs = rlCompileShader(fsCode, RL_FRAGMENT_SHADER);
+	if (vs == 0 || fs == 0)
+	{
+		if (vs != 0) deleteShader(vs);
+		if (fs != 0) deleteShader(fs);
+		return 0;
+	}
+
+	unsigned int program = createProgram();
+	attachShader(program, vs);
+	attachShader(program, fs);
+
+	bindAttribLocation(program, RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, RL_DEFAULT_SHADER_ATTRIB_NAME_POSITION);
+	bindAttribLocation(program, RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD);
+	bindAttribLocation(program, RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL, RL_DEFAULT_SHADER_ATTRIB_NAME_NORMAL);
+	bindAttribLocation(program, RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR, RL_DEFAULT_SHADER_ATTRIB_NAME_COLOR);
+	bindAttribLocation(program, RL_DEFAULT_SHADER_ATTRIB_LOCATION_TANGENT, RL_DEFAULT_SHADER_ATTRIB_NAME_TANGENT);
+	bindAttribLocation(program, RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD2, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD2);
+
+	if (retrievable) programParameteri(program, PROGRAM_BINARY_RETRIEVABLE_HINT, 1);
+	linkProgram(program);
+
+	detachShader(program, vs);
+	detachShader(program, fs);
+	deleteShader(vs);
+	deleteShader(fs);
+
+	int linked = 0;
+	getProgramiv(program, LINK_STATUS, &linked);
+	if (!linked)
+	{
+		int length = 0;
+		getProgramiv(program, INFO_LOG_LENGTH, &length);
+		vector<char> log(length + 1, '\0');
+		if (length > 0) getProgramInfoLog(program, length, nullptr, log.data());
+		cerr << "PROGRAMS: link failed: " << log.data() << endl;
+
+		deleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+// the locations LoadShaderFromMemory sets; locs is freed by UnloadShader
+static void setDefaultLocations(Shader& shader)
+{
+	shader.locs = (int*)calloc(RL_MAX_SHADER_LOCATIONS, sizeof(int));
+	for (int i = 0; i < RL_MAX_SHADER_LOCATIONS; i++) shader.locs[i] = -1;
+
+	shader.locs[SHADER_LOC_VERTEX_POSITION] = rlGetLocationAttrib(shader.id, RL_DEFAULT_SHADER_ATTRIB_NAME_POSITION);
+	shader.locs[SHADER_LOC_VERTEX_TEXCOORD01] = rlGetLocationAttrib(shader.id, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD);
+	shader.locs[SHADER_LOC_VERTEX_TEXCOORD02] = rlGetLocationAttrib(shader.id, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD2);
+	shader.locs[SHADER_LOC_VERTEX_NORMAL] = rlGetLocationAttrib(shader.id, RL_DEFAULT_SHADER_ATTRIB_NAME_NORMAL);
+	shader.locs[SHADER_LOC_VERTEX_TANGENT] = rlGetLocationAttrib(shader.id, RL_DEFAULT_SHADER_ATTRIB_NAME_TANGENT);
+	shader.locs[SHADER_LOC_VERTEX_COLOR] = rlGetLocationAttrib(shader.id, RL_DEFAULT_SHADER_ATTRIB_NAME_COLOR);
+
+	shader.locs[SHADER_LOC_MATRIX_MVP] = rlGetLocationUniform(shader.id, RL_DEFAULT_SHADER_UNIFORM_NAME_MVP);
+	shader.locs[SHADER_LOC_MATRIX_VIEW] = rlGetLocationUniform(shader.id, RL_DEFAULT_SHADER_UNIFORM_NAME_VIEW);
+	shader.locs[SHADER_LOC_MATRIX_PROJECTION] = rlGetLocationUniform(shader.id, RL_DEFAULT_SHADER_UNIFORM_NAME_PROJECTION);
+	shader.locs[SHADER_LOC_MATRIX_MODEL] = rlGetLocationUniform(shader.id, RL_DEFAULT_SHADER_UNIFORM_NAME_MODEL);
+	shader.locs[SHADER_LOC_MATRIX_NORMAL] = rlGetLocationUniform(shader.id, RL_DEFAULT_SHADER_UNIFORM_NAME_NORMAL);
+
+	shader.locs[SHADER_LOC_COLOR_DIFFUSE] = rlGetLocationUniform(shader.id, RL_DEFAULT_SHADER_UNIFORM_NAME_COLOR);
+	shader.locs[SHADER_LOC_MAP_DIFFUSE] = rlGetLocationUniform(shader.id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE0);
+	shader.locs[SHADER_LOC_MAP_SPECULAR] = rlGetLocationUniform(shader.id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE1);
+	shader.locs[SHADER_LOC_MAP_NORMAL] = rlGetLocationUniform(shader.id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE2);
+}
+
+Shader ProgramCache::load(const char* vsCode, const char* fsCode)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	if (!vsCode) vsCode = DEFAULT_VS;
+
+	unsigned long long key = 14695981039346656037ull;
+	key = hashBytes(key, vsCode, strlen(vsCode) + 1);
+	key = hashBytes(key, fsCode, strlen(fsCode) + 1);
+	key = hashBytes(key, driver.data(), driver.size());
+
+	unsigned int program = enabled ? loadBinary(key) : 0;
+	if (program != 0)
+	{
+		hits++;
+	}
+	else
+	{
+		program = linkFromSource(vsCode, fsCode, enabled);
+		compiles++;
+		if (program != 0 && enabled) saveBinary(key, program);
+	}
+
+	Shader shader = {};
+	shader.id = program;
+	if (program != 0) setDefaultLocations(shader);
+
+	ms += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	return shader;
+}
+
+Shader ProgramCache::loadFile(const char* vsPath, const char* fsPath)
+{
+	char* vs = vsPath ? LoadFileText(vsPath) : nullptr;
+	char* fs = LoadFileText(fsPath);
+
+	Shader shader = {};
+	if (fs && (vs || !vsPath)) shader = load(vs, fs);
+	else cerr << "PROGRAMS: couldn't read " << (fs ? vsPath : fsPath) << endl;
+
+	UnloadFileText(vs);
+	UnloadFileText(fs);
+	return shader;
+}
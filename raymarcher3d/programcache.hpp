@@ -0,0 +1,50 @@
+#ifndef PROGRAMCACHE_HPP
+#define PROGRAMCACHE_HPP
+
+#include "raylib.h"
+#include <string>
+
+// On-disk cache of linked shader programs.
+//
+// load() is LoadShaderFromMemory with a cache in front: the program binary
+// from glGetProgramBinary is written to dir, keyed by a hash of both stages'
+// source and the GL vendor, renderer and version strings. The next launch
+// hands the binary straight to glProgramBinary and skips compiling. A
+// missing, mismatched or rejected binary (a driver update can invalidate
+// any of them) falls back to compiling from source and is rewritten.
+// Without program binary support it only compiles.
+//
+// Every topology and feature set the scene shader is built for adds a
+// file, so init() prunes the directory: files for another driver go, then
+// the least recently loaded until it is within maxFiles and maxBytes.
+
+class ProgramCache
+{
+public:
+	std::string dir = "shadercache";
+	bool enabled = false;			// set by init() if the driver has binary formats
+	int maxFiles = 256;
+	long long maxBytes = 64ll << 20;
+
+	int hits = 0;
+	int compiles = 0;
+	int pruned = 0;					// files deleted by init()
+	double ms = 0.0;				// spent in load(), both ways
+
+	void init();					// after InitWindow, needs the GL context
+
+	// raylib Shader with the usual locations set; vsCode nullptr is raylib's
+	// default vertex shader. id 0 if compiling or linking failed
+	Shader load(const char* vsCode, const char* fsCode);
+	Shader loadFile(const char* vsPath, const char* fsPath);	// as LoadShader
+
+private:
+	std::string driver;
+
+	void prune();
+	unsigned int loadBinary(unsigned long long key);
+	void saveBinary(unsigned long long key, unsigned int program);
+	std::string path(unsigned long long key) const;
+};
+
+#endif
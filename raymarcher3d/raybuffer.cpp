@@ -0,0 +1,121 @@
+#include "raybuffer.hpp"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+static void* alignedAlloc(size_t bytes)
+{
+#ifdef _MSC_VER
+	return _aligned_malloc(bytes, RAY_ALIGN);
+#else
+	void* p = nullptr;
+	if (posix_memalign(&p, RAY_ALIGN, bytes) != 0) return nullptr;
+	return p;
+#endif
+}
+
+static void alignedFree(void* p)
+{
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+RayBuffer::RayBuffer(RayBuffer&& other)
+{
+	take(other);
+}
+
+RayBuffer& RayBuffer::operator=(RayBuffer&& other)
+{
+	if (this != &other)
+	{
+		release();
+		take(other);
+	}
+	return *this;
+}
+
+void RayBuffer::take(RayBuffer& other)
+{
+	ox = other.ox; oy = other.oy; oz = other.oz;
+	dx = other.dx; dy = other.dy; dz = other.dz;
+	t = other.t;
+	steps = other.steps;
+	evals = other.evals;
+	width = other.width; height = other.height;
+	count = other.count; capacity = other.capacity;
+
+	other.ox = other.oy = other.oz = other.dx = other.dy = other.dz = other.t = nullptr;
+	other.steps = other.evals = nullptr;
+	other.width = other.height = other.count = other.capacity = 0;
+}
+
+RayBuffer::~RayBuffer()
+{
+	release();
+}
+
+void RayBuffer::release()
+{
+	alignedFree(ox); alignedFree(oy); alignedFree(oz);
+	alignedFree(dx); alignedFree(dy); alignedFree(dz);
+	alignedFree(t);
+	alignedFree(steps);
+	alignedFree(evals);
+
+	ox = oy = oz = dx = dy = dz = t = nullptr;
+	steps = evals = nullptr;
+	capacity = 0;
+}
+
+void RayBuffer::resize(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	count = width * height;
+
+	if (count <= capacity)
+	{
+		return;
+	}
+
+	release();
+	capacity = (count + RAY_PACKET_PAD - 1) / RAY_PACKET_PAD * RAY_PACKET_PAD;
+
+	size_t bytes = sizeof(float) * capacity;
+	ox = (float*)alignedAlloc(bytes); oy = (float*)alignedAlloc(bytes); oz = (float*)alignedAlloc(bytes);
+	dx = (float*)alignedAlloc(bytes); dy = (float*)alignedAlloc(bytes); dz = (float*)alignedAlloc(bytes);
+	t = (float*)alignedAlloc(bytes);
+	steps = (int*)alignedAlloc(sizeof(int) * capacity);
+	evals = (int*)alignedAlloc(sizeof(int) * capacity);
+
+	// padding lanes march nowhere: zero them once so packets read finite values
+	memset(ox, 0, bytes); memset(oy, 0, bytes); memset(oz, 0, bytes);
+	memset(dx, 0, bytes); memset(dy, 0, bytes); memset(dz, 0, bytes);
+	memset(t, 0, bytes);
+	memset(steps, 0, sizeof(int) * capacity);
+	memset(evals, 0, sizeof(int) * capacity);
+}
+
+double RayBuffer::averageSteps() const
+{
+	if (count == 0) return 0.0;
+
+	long long total = 0;
+	for (int i = 0; i < count; i++) total += steps[i];
+	return (double)total / count;
+}
+
+double RayBuffer::averageEvals() const
+{
+	if (count == 0) return 0.0;
+
+	long long total = 0;
+	for (int i = 0; i < count; i++) total += evals[i];
+	return (double)total / count;
+}
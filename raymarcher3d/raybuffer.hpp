@@ -0,0 +1,60 @@
+#ifndef RAYBUFFER_HPP
+#define RAYBUFFER_HPP
+
+#include "raylib.h"
+
+// Structure-of-arrays ray store, one lane per pixel at render resolution.
+// Arrays are 64-byte aligned and padded to a multiple of RAY_PACKET_PAD so
+// SIMD code can load whole packets without a scalar tail.
+
+constexpr int RAY_ALIGN = 64;
+constexpr int RAY_PACKET_PAD = 16;
+
+class RayBuffer
+{
+public:
+	float* ox = nullptr;		// origin
+	float* oy = nullptr;
+	float* oz = nullptr;
+	float* dx = nullptr;		// direction
+	float* dy = nullptr;
+	float* dz = nullptr;
+	float* t = nullptr;			// distance travelled
+	int* steps = nullptr;		// steps taken
+	int* evals = nullptr;		// scene SDF evaluations, march + shading
+
+	int width = 0;
+	int height = 0;
+	int count = 0;				// width * height
+	int capacity = 0;			// allocated lanes (padded)
+
+	RayBuffer() {}
+	RayBuffer(RayBuffer&& other);
+	RayBuffer& operator=(RayBuffer&& other);
+	RayBuffer(const RayBuffer&) = delete;
+	RayBuffer& operator=(const RayBuffer&) = delete;
+	~RayBuffer();
+
+	void resize(int width, int height);		// only reallocates when growing
+	double averageSteps() const;			// mean of steps over all rays
+	double averageEvals() const;			// mean of evals over all rays
+
+	Vector3 origin(int idx) const { return { ox[idx], oy[idx], oz[idx] }; }
+	Vector3 dir(int idx) const { return { dx[idx], dy[idx], dz[idx] }; }
+	Vector3 position(int idx) const { return { ox[idx] + dx[idx] * t[idx], oy[idx] + dy[idx] * t[idx], oz[idx] + dz[idx] * t[idx] }; }
+
+	void setRay(int idx, Vector3 origin, Vector3 dir)
+	{
+		ox[idx] = origin.x; oy[idx] = origin.y; oz[idx] = origin.z;
+		dx[idx] = dir.x; dy[idx] = dir.y; dz[idx] = dir.z;
+		t[idx] = 0.0f;
+		steps[idx] = 0;
+		evals[idx] = 0;
+	}
+
+private:
+	void release();
+	void take(RayBuffer& other);
+};
+
+#endif
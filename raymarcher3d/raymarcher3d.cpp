@@ -2,7 +2,22 @@
 #include <stdio.h>
 #include "raylib.h"
 #include "raymath.h"
+#include "rlgl.h"
 #include "input.hpp"
+#include "engine.hpp"
+#include "cpurender.hpp"
+#include "bench.hpp"
+#include "depthtargets.hpp"
+#include "dirtyregion.hpp"
+#include "heatmap.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "rendertargets.hpp"
+#include "uniformblocks.hpp"
+#include "shapebuffer.hpp"
+#include "scenegen.hpp"
+#include "programcache.hpp"
+#include "tilebinning.hpp"
 #include <vector>
 #include <string>
 
@@ -33,12 +48,11 @@ int action_rotDown[2] = { KEY_DOWN,KEY_DOWN };
 int action_descend[2] = { KEY_LEFT_CONTROL, KEY_LEFT_CONTROL };
 int action_ascend[2] = { KEY_SPACE, KEY_SPACE };
 
-constexpr int screenX = 800;
-constexpr int screenY = 600;
 float resScale = 0.5;
 
 // PARAMETERS TO EDIT
 float k = 1.0f;
+SminMode sminMode = SMIN_EXPONENTIAL;	// CPU path only, the shader always uses the polynomial smin
 float speed = 1.8f;
 float mouseSens = 0.2;
 
@@ -48,15 +62,37 @@ Vector3 lightCol = { 1.0, 1.0, 1.0 };
 Vector3 bgColor = { 0.1, 0.1, 0.2 };
 
 float shininess = 22.0;
-float specular = 1.0;
+float specular = 1.0;		// 0 compiles specular out
 
 float shadowIntensity = 1.0;
+bool softShadows = true;
+bool showLight = true;		// draw the light as a small sphere
 float shadowSmoothness = 1.0;
 float shadowBias = 100;
 
 Vector3 glowCol = { 1.0, 1.0, 1.0 };
 float glowIntensity = 0.01;
 
+bool depthReuse = false;
+float depthReuseFraction = 0.8f;
+
+bool incremental = false;	// only re-render regions touched by shape edits
+
+bool unrollScene = true;	// scene-specialised shader per shape topology (scenegen.hpp)
+bool tileBinning = false;	// primary rays march only their screen tile's shapes (tilebinning.hpp)
+
+bool countSteps = false;
+float avgSteps = 0.0f;
+
+bool showProfiler = true;
+
+int maxListedShapes = 32;	// larger scenes are edited one shape at a time
+int editShape = 0;
+
+int heatmapMode = HEATMAP_OFF;
+float heatmapMax = 64.0f;
+float heatmapBlend = 0.75f;
+
 int aoSteps = 5;
 float aoStepSize = 0.05;
 float aoBias = 0.5;
@@ -64,272 +100,68 @@ float aoBias = 0.5;
 
 bool isCursor = true;
 
-class Shape;
-class Sphere;
-class Box;
-class Cam3d;
-class RayMarch;
-
-Vector2 oneDtoTwoD(int, int);
-Vector3 absVec(Vector3);
-float SdfMinOfAll(Shape*[], Vector3, int, float);
-float smin(float, float, float);
-float min(float, float);
 Vector3 EulerToDirection(Vector3);
 void printVec(Vector3);
 void printDirs(vector<RayMarch>);
 Color addCols(Color, Color, float);
 void swapCursor();
 Vector2 resolution(bool);
+void saveTrace(TraceRecorder&, int);
+int shaderFeatures();
 
-class Shape
-{
-public:	
-	Vector3 origin;
-
-	virtual float sdf(Vector3 pt)
-	{
-		return 6.7f;
-	}
-};
-
-class Sphere : public Shape
-{
-public:
-	float radius;
-
-	Sphere(Vector3 origin, float radius)
-	{
-		this->origin = origin;
-		this->radius = radius;
-	}
-
-	float sdf(Vector3 pt) override
-	{
-		Vector3 newPt = pt - origin;
-		return Vector3Length(newPt) - radius;
-	}
-};
-class Box : public Shape
-{
-public:
-	Vector3 lengths;
-	float& x = lengths.x;
-	float& y = lengths.y;
-	float& z = lengths.z;
-
-	Box(Vector3 origin, Vector3 lengths)
-	{
-		this->lengths = lengths;
-		this->origin = origin;
-	}
-	
-	float sdf(Vector3 pt) override
-	{
-		Vector3 newPt = pt - origin;
-
-		Vector3 q = absVec(newPt) - lengths;
-		return Vector3Length(Vector3Max(q, Vector3Zero())) + 
-			min(max(q.x, max(q.y, q.z)), 0.0f);
-	}
-};
-class Torus : public Shape
+// everything besides the shape arrays that changes the rendered frame,
+// compared bytewise by the dirty tracker. The depth reuse fields of the
+// camera block are left zero, they follow from the tracker's answer
+struct FrameGlobals
 {
-public:
-	Vector2 torusValues = { 1.0, 1.0 };
-
-	Torus(Vector3 origin, Vector2 values)
-	{
-		this->origin = origin;
-		torusValues = values;
-	}
-
-	float sdf(Vector3 pt) override
-	{
-		Vector3 newPt = pt - origin;
-
-		Vector2 q = { Vector2Length({newPt.x, newPt.z}) - torusValues.x, newPt.y };
-		return Vector2Length(q) - torusValues.y;
-	}
+	CameraUniforms camera;
+	LightingUniforms lighting;
+	float k;
+	int features;
 };
 
-class RayMarch
-{
-public:
-	Vector2 pixel;
-	Vector3 origin;
-	Vector3 dir;
-	float totalDistance = 0.0f;
-	int stepsTaken = 0.0f;
-
-	RayMarch()
-	{
-
-	}
-
-	RayMarch(Vector3 origin, Vector3 offset)
-	{
-		this->origin = origin;
-		dir = offset;
-	}
-
-	void march(float length, Vector3 dir)
-	{
-		origin += dir * length;
-		totalDistance += length;
-		stepsTaken++;
-	}
-};
+//-------------------------------------------------------MAIN PROGRAM
 
-class Cam3d
+int main(int argc, char* argv[])
 {
-public:
-	Vector3 origin = { 0.0f, 0.0f, 0.0f };
-	Vector3 dir = { 0, 0, -1 };
-	Vector2 rotation = { 0, 0 };
-
-	float moveSpeed = 0.1;
-	float rotSpeed = 0.02;
-
-	float fov;
-
-	Vector3 worldUp()
-	{
-		if (fabs(Vector3DotProduct(forward(), { 0.0f, 1.0f, 0.0f })) > 0.999f)
-		{
-			return { 1.0f, 0.0f, 0.0f };
-		}
-		return { 0.0f, 1.0f, 0.0f };
-	}
-
-	Vector3 forward()
-	{
-		return Vector3Normalize(dir);
-	}
-	Vector3 right()
-	{
-		return Vector3Normalize(Vector3CrossProduct(worldUp(), forward()));
-	}
-	Vector3 up()
-	{
-		return Vector3CrossProduct(forward(), right());
-	}
-
-	void rotate(bool isYaw, float amount)
-	{
-		amount *= rotSpeed;
-		if (isYaw)
-		{
-			dir = Vector3RotateByAxisAngle(dir, { 0.0, 1.0, 0.0 }, amount);
-		}
-		else
-		{
-			dir = Vector3RotateByAxisAngle(dir, right(), amount);
-
-			if (dir.y > 1.0f) dir.y = 1.0f;
-			if (dir.y < -1.0f) dir.y = -1.0f;
-
-		}
-
-		dir = Vector3Normalize(dir);
-	}
-	void move(Vector3 d)
-	{
-		Vector3 dir = Vector3Zero();
-		cout << dir.x << " " << dir.z << endl;
-		dir = Vector3Add(Vector3Scale(right(), d.x), dir);
-		dir = Vector3Add(Vector3Scale(forward(), -d.z), dir);
-		dir.y += d.y;
-
-		cout << dir.x << " " << dir.z << endl;
-
-		origin += dir * moveSpeed;
-	}
-
-	float clipEnd = 100.0f;
-	float hitThreshold = 0.001f;
+	// the scene, grown and shrunk from the UI
+	vector<int> shapeTypes = {1, 0};
+	vector<Vector3> shapePositions = {
+		{-2.0f, 3.5f, -1.0f},
+		{0.0f, 0.0f, 0.0f}
+	};
+	vector<Vector3> shapeSizes = {
+		{1.5f, 1.5f, 1.5f},
+		{1.0f, 1.0f, 1.0f}
+	};
+	vector<Vector3> shapeCols = {
+		{0.8, 0.2, 0.2},
+		{0.8, 0.9, 0.1}
+	};
+	int shapesLength = (int)shapeTypes.size();
 
-	std::vector<RayMarch> rays{ screenX * screenY };
+	Cam3d cam = Cam3d();
+	cam.origin = { 0.0, 0.0, 5.0 };
 
-	Cam3d()
+	// CPU engine benchmarks
+	BenchOptions bench;
+	if (parseBenchArgs(argc, argv, bench))
 	{
-		dir = { 0.0f, 0.0f, -1.0f };
-		fov = PI/2.5;
+		return runBenchmarks(bench);
 	}
 
-	void initRays()
+	// headless CPU render, no window or GPU needed
+	HeadlessOptions headless;
+	if (parseHeadlessArgs(argc, argv, headless))
 	{
-		// FOV stuff
-		float aspect = (float)screenX / (float)screenY;
-		float halfHeight = tanf(fov / 2.0f);
-		float halfWidth = aspect * halfHeight;
-
-		for (int idx = 0; idx < screenX * screenY; idx++)
-		{
-			Vector2 pixel = oneDtoTwoD(idx, screenX);
-			rays[idx].pixel = pixel;
-
-			float u = (pixel.x + 0.5f) / screenX;
-			float v = (pixel.y + 0.5f) / screenY;
+		vector<Shape*> cpuShapes;
+		int cpuCount = buildShapes(shapeTypes.data(), shapePositions.data(), shapeSizes.data(), shapeCols.data(), shapesLength, cpuShapes);
 
-			float x = (2.0f * u - 1.0f) * halfWidth;
-			float y = (1.0f - 2.0f * v) * halfHeight;
-
-			Vector3 dir = Vector3Normalize(
-				Vector3Add(Vector3Add(forward(), Vector3Scale(right(), x)), Vector3Scale(up(), y))
-			);
-
-			rays[idx].origin = origin;
-			rays[idx].totalDistance = 0.0f;
-			rays[idx].dir = dir;
-			rays[idx].stepsTaken = 0;
-		}
+		int result = runHeadless(headless, cam, cpuShapes.data(), cpuCount, { lightPos, lightCol, bgColor });
+		freeShapes(cpuShapes);
+		return result;
 	}
 
-	int marchRay(RayMarch& r, Shape* shapes[], int size, bool printData)
-	{
-		float length = hitThreshold;
-		while (r.totalDistance < clipEnd && length >= hitThreshold)
-		{
-			if (printData)
-			{
-				cout << "MARCHING! ";
-			}
-			length = SdfMinOfAll(shapes, r.origin, size, k);
-			if (length < 0.0f)
-			{
-				return 0;
-			}
-			r.march(length, r.dir);
-			
-		}
-		//cout << "ENDLOOP!";
-
-		if (r.totalDistance > clipEnd)
-		{
-			return 1; // RAY HIT DEAD AIR!
-			cout << endl << "NO HIT!";
-		}
-		else
-		{
-			return 0; // RAY HIT OBJECT!
-			cout << endl << "HIT!";
-		}
-	}
-
-
-	float verticalFOV()
-	{
-		return (fov / screenX) * screenY;
-	}
-};
-
-
-//-------------------------------------------------------MAIN PROGRAM
-
-int main()
-{
-
 	// window setup
 	InitWindow((screenX) + 300, screenY, "program");
 
@@ -339,80 +171,100 @@ int main()
 	SetTargetFPS(60);
 	
 	// setup shader stuff
-	Shader shader = LoadShader(0, "raymarcher3d.fs");
-	Shader aaShader = LoadShader(0, "antiAlias.fs");
+	// linked programs are kept on disk, so only the first launch compiles
+	ProgramCache programCache;
+	programCache.init();
+
+	// the generic shader, plus unrolled variants compiled per scene topology
+	SceneShaderCache sceneShaders;
+	sceneShaders.binaries = &programCache;
+	sceneShaders.load("raymarcher3d.fs");
+
+	// per tile shape lists for the march, off if compute shaders aren't there
+	TileBinner tileBinner;
+	if (!tileBinner.load("tilebin.comp")) tileBinning = false;
+
+	sceneShaders.get(shapeTypes.data(), shapesLength, shaderFeatures(), unrollScene);
+	Shader aaShader = programCache.loadFile(nullptr, "antiAlias.fs");
+
+	cout << "SHADERS: " << programCache.ms << " ms, " << programCache.hits << " from cache, " << programCache.compiles << " compiled ("
+		<< (!programCache.enabled ? "no program binaries" : programCache.compiles ? "cold" : "warm") << ")";
+	if (programCache.pruned > 0) cout << ", " << programCache.pruned << " cache files pruned";
+	cout << endl;
 
 	int resLocAA = GetShaderLocation(aaShader, "resolution");
+	Vector2 aaRes = { 0.0f, 0.0f };
 	
 
-	if (shader.id == 0) {
+	if (sceneShaders.generic.shader.id == 0) {
 		std::cerr << "Shader failed to load or compile!" << std::endl;
 	}
 
-	// get shader locations
-	int resLoc = GetShaderLocation(shader, "iResolution");
-	int timeLoc = GetShaderLocation(shader, "iTime");
-
-	int countLoc = GetShaderLocation(shader, "shapeCount");
-	int kLoc = GetShaderLocation(shader, "k");
-
-	int typesLoc = GetShaderLocation(shader, "shapeTypes");
-	int origLoc = GetShaderLocation(shader, "shapeOrigins");
-	int sizeLoc = GetShaderLocation(shader, "shapeSizes");
-	int colsLoc = GetShaderLocation(shader, "shapeCols");
-
-	int camOriginLoc = GetShaderLocation(shader, "camOrigin");
-	int camDirLoc = GetShaderLocation(shader, "camDir");
-	int camFovLoc = GetShaderLocation(shader, "camFOV");
-	int clipEndLoc = GetShaderLocation(shader, "clipEnd");
-	int hitThresholdLoc = GetShaderLocation(shader, "hitThreshold");
-
-	// debug params
-	int sbLoc = GetShaderLocation(shader, "sb");
-	int lightColLoc = GetShaderLocation(shader, "lightColor");
-	int lightLoc = GetShaderLocation(shader, "lightPos");
-	int bgColLoc = GetShaderLocation(shader, "bgColor");
-	int shininessLoc = GetShaderLocation(shader, "shininess");
-	int glowColLoc = GetShaderLocation(shader, "glowCol");
-	int glowIntensityLoc = GetShaderLocation(shader, "glowIntensity");
-	int shadowSmoothLoc = GetShaderLocation(shader, "shadowSmoothness");
-	int aoStepsLoc = GetShaderLocation(shader, "aoSteps");
-	int aoStepSizeLoc = GetShaderLocation(shader, "aoStepSize");
-	int aoBiasLoc = GetShaderLocation(shader, "aoBias");
+	// everything else goes through uniform blocks, uploaded when they change
+	UniformBlock cameraBlock, lightingBlock, shapeBlock;
+	cameraBlock.load(BINDING_CAMERA, sizeof(CameraUniforms));
+	lightingBlock.load(BINDING_LIGHTING, sizeof(LightingUniforms));
+	shapeBlock.load(BINDING_SHAPES, sizeof(ShapeUniforms));
+	int uniformBytes = 0;
+
+	// shapes live in a storage buffer, only edited ones are re-uploaded
+	ShapeBuffer shapeBuffer;
+
+	// last frame's hit distances for depth reuse
+	DepthTargets depthTargets;
+	SceneHistory sceneHistory;
+
+	// total steps / rays written by the shader, read back when counting
+	unsigned int stepStats[2] = { 0, 0 };
+	unsigned int stepStatsSSBO = rlLoadShaderBuffer(sizeof(stepStats), stepStats, RL_DYNAMIC_DRAW);
+
+	// per pixel (steps, evaluations) for the heatmap, allocated when first shown
+	unsigned int pixelCostSSBO = 0;
+	int pixelCostCount = 0;
+	bool dumpHeatmap = false;
+
+	// screen regions to re-march after shape edits
+	DirtyTracker dirty;
+	int dirtyPercent = 100;
 
 	swapCursor();
 
-	int shapesLength = 2;
-	int shapeTypes[] = {1, 0, 3};
-	Vector3 shapePositions[] = {
-		{-2.0f, 3.5f, -1.0f},
-		{0.0f, 0.0f, 0.0f},
-		{2.0, -2.0, -2.0}
-	};
-	Vector3 shapeSizes[] = {
-		{1.5f, 1.5f, 1.5f},
-		{1.0f, 1.0f, 1.0f},
-		{8.0, 10.0, 3.0}
-	};
-	Vector3 shapeCols[] = {
-		{0.8, 0.2, 0.2},
-		{0.8, 0.9, 0.1},
-		{0.0, 1.0, 1.0}
-	};
+	// stage timings, cheap enough to always run; the panel is optional
+	FrameProfiler profiler;
+	profiler.init();
 
-	Cam3d cam = Cam3d();
-	cam.origin = { 0.0, 0.0, 5.0 };
+	// F9 starts a trace capture and F9 again (or exit) writes it
+	TraceRecorder trace;
+	trace.nameThread(TRACE_TID_MAIN, "Main");
+	trace.nameThread(TRACE_TID_GPU, "GPU");
+	profiler.trace = &trace;
+	int traceCount = 0;
 
+	// scene target persists so unchanged regions can be kept; resolution
+	// changes swap targets through the pool instead of reallocating
+	RenderTargetPool targets;
+	Vector2 targetRes = resolution(true);
+	RenderTexture2D sceneRT = targets.acquire(targetRes.x, targetRes.y);
+	RenderTexture2D postRT = targets.acquire(targetRes.x, targetRes.y);
 
 	// ----------------- GAME LOOP
 	while (WindowShouldClose() == false)
 	{
+		profiler.beginFrame();
+		profiler.begin(STAGE_INPUT);
+
 		Vector2 r = resolution(true);
 		Vector2 r2 = resolution(false);
-		RenderTexture2D sceneRT = LoadRenderTexture(r.x, r.y);
-		RenderTexture2D postRT = LoadRenderTexture(r.x, r.y);
-	
-		float time = GetTime();
+		if ((int)r.x != (int)targetRes.x || (int)r.y != (int)targetRes.y)
+		{
+			targets.release(sceneRT);
+			targets.release(postRT);
+			targetRes = r;
+			sceneRT = targets.acquire(r.x, r.y);
+			postRT = targets.acquire(r.x, r.y);
+			dirty.invalidate();
+		}
+		targets.trim(GetTime());
 		
 		//------------------------INPUT
 		Vector2 moveInput = actionVector(action_mvLeft, action_mvRight, action_mvForward, action_mvBackward);
@@ -424,6 +276,12 @@ int main()
 		{
 			swapCursor();
 		}
+
+		if (IsKeyPressed(KEY_F9))
+		{
+			if (!trace.capturing) trace.start();
+			else saveTrace(trace, traceCount++);
+		}
 		
 		Vector2 lookInput = Vector2Zero();
 		if(!isCursor) lookInput = mouseMovement() * mouseSens;
@@ -433,37 +291,119 @@ int main()
 		if(lookInput.x) cam.rotate(true, lookInput.x);
 		if(lookInput.y) cam.rotate(false,-lookInput.y);
 
-		SetShaderValue(aaShader, resLocAA, &r, SHADER_UNIFORM_VEC2);
-
-		SetShaderValue(shader, resLoc, &r, SHADER_UNIFORM_VEC2);
-		SetShaderValue(shader, timeLoc, &time, SHADER_UNIFORM_FLOAT);
-
-		SetShaderValue(shader, countLoc, &shapesLength, SHADER_UNIFORM_INT);
-		SetShaderValue(shader, kLoc, &k, SHADER_UNIFORM_FLOAT);
-
-		SetShaderValueV(shader, typesLoc, &shapeTypes, SHADER_UNIFORM_INT, shapesLength);
-		SetShaderValueV(shader, origLoc, &shapePositions, SHADER_UNIFORM_VEC3, shapesLength);
-		SetShaderValueV(shader, sizeLoc, &shapeSizes, SHADER_UNIFORM_VEC3, shapesLength);
-		SetShaderValueV(shader, colsLoc, &shapeCols, SHADER_UNIFORM_VEC3, shapesLength);
-
-		SetShaderValue(shader, camOriginLoc, &cam.origin, SHADER_UNIFORM_VEC3);
-		SetShaderValue(shader, camDirLoc, &cam.dir, SHADER_UNIFORM_VEC3);
-		SetShaderValue(shader, camFovLoc, &cam.fov, SHADER_UNIFORM_FLOAT);
-		SetShaderValue(shader, clipEndLoc, &cam.clipEnd, SHADER_UNIFORM_FLOAT);
-		SetShaderValue(shader, hitThresholdLoc, &cam.hitThreshold, SHADER_UNIFORM_FLOAT);
-
-		// debug params
-		SetShaderValue(shader, sbLoc, &shadowBias, SHADER_UNIFORM_FLOAT);
-		SetShaderValue(shader, lightLoc, &lightPos, SHADER_UNIFORM_VEC3);
-		SetShaderValue(shader, lightColLoc, &lightCol, SHADER_UNIFORM_VEC3);
-		SetShaderValue(shader, bgColLoc, &bgColor, SHADER_UNIFORM_VEC3);
-		SetShaderValue(shader, shininessLoc, &shininess, SHADER_UNIFORM_FLOAT);
-		SetShaderValue(shader, glowColLoc, &glowCol, SHADER_UNIFORM_VEC3);
-		SetShaderValue(shader, glowIntensityLoc, &glowIntensity, SHADER_UNIFORM_FLOAT);
-		SetShaderValue(shader, shadowSmoothLoc, &shadowSmoothness, SHADER_UNIFORM_FLOAT);
-		SetShaderValue(shader, aoStepsLoc, &aoSteps, SHADER_UNIFORM_INT);
-		SetShaderValue(shader, aoStepSizeLoc, &aoStepSize, SHADER_UNIFORM_FLOAT);
-		SetShaderValue(shader, aoBiasLoc, &aoBias, SHADER_UNIFORM_FLOAT);
+		profiler.end(STAGE_INPUT);
+		profiler.begin(STAGE_UNIFORMS);
+
+		if (r.x != aaRes.x || r.y != aaRes.y)
+		{
+			SetShaderValue(aaShader, resLocAA, &r, SHADER_UNIFORM_VEC2);
+			aaRes = r;
+		}
+
+		CameraUniforms camera = {};
+		camera.camOrigin = cam.origin;
+		camera.camDir = cam.dir;
+		camera.camFOV = cam.fov;
+		camera.clipEnd = cam.clipEnd;
+		camera.hitThreshold = cam.hitThreshold;
+		camera.relaxation = cam.relaxation;
+		camera.iResolution = r;
+		camera.countSteps = countSteps;
+		camera.adaptiveThreshold = cam.adaptiveThreshold;
+		camera.heatmapMode = heatmapMode;
+		camera.heatmapMax = heatmapMax;
+		camera.heatmapBlend = heatmapBlend;
+
+		LightingUniforms lighting = {};
+		lighting.lightPos = lightPos;
+		lighting.sb = shadowBias;
+		lighting.lightColor = lightCol;
+		lighting.shininess = shininess;
+		lighting.bgColor = bgColor;
+		lighting.glowIntensity = glowIntensity;
+		lighting.glowCol = glowCol;
+		lighting.shadowSmoothness = shadowSmoothness;
+		lighting.aoSteps = aoSteps;
+		lighting.aoStepSize = aoStepSize;
+		lighting.aoBias = aoBias;
+		lighting.specularStrength = specular;
+
+		ShapeUniforms shapeData = {};
+		shapeData.shapeCount = shapesLength;
+		shapeData.k = k;
+
+		if (heatmapMode != HEATMAP_OFF && pixelCostCount != (int)r.x * (int)r.y)
+		{
+			if (pixelCostSSBO != 0) rlUnloadShaderBuffer(pixelCostSSBO);
+			pixelCostCount = (int)r.x * (int)r.y;
+			pixelCostSSBO = rlLoadShaderBuffer(pixelCostCount * 2 * sizeof(unsigned int), nullptr, RL_DYNAMIC_COPY);
+			dirty.invalidate();
+		}
+
+		// work out what to re-render from the values about to be uploaded
+		bool render = true;
+		if (incremental)
+		{
+			FrameGlobals globals = {};
+			globals.camera = camera;
+			globals.lighting = lighting;
+			globals.k = k;
+			globals.features = shaderFeatures();
+
+			// the shader's polynomial smin reaches 4k, AO samples reach aoSteps * aoStepSize
+			float margin = 4.0f * k + aoSteps * aoStepSize;
+			render = dirty.update(shapeTypes.data(), shapePositions.data(), shapeSizes.data(), shapeCols.data(), shapesLength, &globals, sizeof(globals),
+				cam.origin, cam.dir, cam.fov, lightPos, margin, (int)r.x, (int)r.y);
+			dirtyPercent = (int)(100.0f * dirty.dirtyPixels() / (r.x * r.y));
+		}
+		else
+		{
+			dirty.invalidate();
+			dirty.full = true;
+			dirtyPercent = 100;
+		}
+
+		// partial frames would leave the depth history half stale
+		if (depthReuse && dirty.full)
+		{
+			depthTargets.resize((int)r.x, (int)r.y);
+			depthTargets.attach(sceneRT);
+		}
+		else
+		{
+			depthTargets.valid = false;
+		}
+
+		// last frame's depths only seed rays while just the camera moves
+		if (sceneHistory.changed(shapeTypes.data(), shapePositions.data(), shapeSizes.data(), shapesLength, k))
+		{
+			depthTargets.valid = false;
+		}
+
+		int depthReuseInt = depthReuse && depthTargets.valid;
+		camera.depthReuse = depthReuseInt;
+		if (depthReuseInt)
+		{
+			camera.depthReuseFraction = depthReuseFraction;
+			camera.prevCamOrigin = depthTargets.prevOrigin;
+			camera.prevCamDir = depthTargets.prevDir;
+		}
+
+		cameraBlock.resetStats();
+		lightingBlock.resetStats();
+		shapeBlock.resetStats();
+		shapeBuffer.resetStats();
+		cameraBlock.update(&camera);
+		lightingBlock.update(&lighting);
+		shapeBlock.update(&shapeData);
+		shapeBuffer.sync(shapeTypes.data(), shapePositions.data(), shapeSizes.data(), shapeCols.data(), shapesLength);
+
+		// a new topology or feature set compiles here, once
+		const SceneProgram& program = sceneShaders.get(shapeTypes.data(), shapesLength, shaderFeatures(), unrollScene);
+		// idle and partial frames would skew the generic / unrolled comparison
+		profiler.sceneVariant = (render && dirty.full) ? program.unrolled : -1;
+		profiler.sceneFeatures = program.features;
+		uniformBytes = cameraBlock.bytesUploaded + lightingBlock.bytesUploaded + shapeBlock.bytesUploaded + shapeBuffer.bytesUploaded;
 
 		if (IsKeyDown(KEY_ONE))
 		{
@@ -488,24 +428,96 @@ int main()
 		}
 
 
+		profiler.end(STAGE_UNIFORMS);
+
 		//------------------------DRAWING
 		
 		
 		// BEGIN DRAWING
-		BeginTextureMode(sceneRT);
-		ClearBackground(BLACK);
-		BeginShaderMode(shader);
-		DrawRectangle(0, 0, screenX*resScale, screenY*resScale, WHITE);
-		EndShaderMode();
-		EndTextureMode();
+		profiler.begin(STAGE_SCENE);
+		if (countSteps && render)
+		{
+			stepStats[0] = stepStats[1] = 0;
+			rlUpdateShaderBuffer(stepStatsSSBO, stepStats, sizeof(stepStats), 0);
+		}
+		rlBindShaderBuffer(stepStatsSSBO, 1);
+		if (pixelCostSSBO != 0) rlBindShaderBuffer(pixelCostSSBO, 2);
+
+		if (render && (program.features & FEATURE_TILE_BINNING)) tileBinner.dispatch((int)r.x, (int)r.y, shapesLength);
+
+		if (render)
+		{
+			BeginTextureMode(sceneRT);
+			if (dirty.full) ClearBackground(BLACK);
+			BeginShaderMode(program.shader);
+			if (depthReuseInt) SetShaderValueTexture(program.shader, program.prevHitDistanceLoc, depthTargets.previous());
 
+			if (dirty.full)
+			{
+				DrawRectangle(0, 0, screenX*resScale, screenY*resScale, WHITE);
+			}
+			else
+			{
+				// rects are in gl_FragCoord space, which is what glScissor takes
+				for (int i = 0; i < dirty.rects.size(); i++)
+				{
+					const ScreenRect& rect = dirty.rects[i];
+					rlDrawRenderBatchActive();
+					rlEnableScissorTest();
+					rlScissor(rect.x0, rect.y0, rect.x1 - rect.x0, rect.y1 - rect.y0);
+					DrawRectangle(0, 0, screenX*resScale, screenY*resScale, WHITE);
+					rlDrawRenderBatchActive();
+					rlDisableScissorTest();
+				}
+			}
+
+			EndShaderMode();
+			EndTextureMode();
+
+			if (depthReuse && dirty.full) depthTargets.endFrame(cam.origin, cam.dir);
+		}
+
+		// stalls on the GPU, only while counting
+		if (countSteps && render)
+		{
+			rlReadShaderBuffer(stepStatsSSBO, stepStats, sizeof(stepStats), 0);
+			avgSteps = stepStats[1] ? (float)stepStats[0] / stepStats[1] : 0.0f;
+		}
+
+		// raw counts as 16-bit PGMs plus the false-colour view, in render resolution
+		if (dumpHeatmap && heatmapMode != HEATMAP_OFF)
+		{
+			vector<unsigned int> cost(pixelCostCount * 2);
+			rlReadShaderBuffer(pixelCostSSBO, cost.data(), cost.size() * sizeof(unsigned int), 0);
+
+			vector<int> steps(pixelCostCount), evals(pixelCostCount);
+			for (int i = 0; i < pixelCostCount; i++)
+			{
+				steps[i] = (int)cost[i * 2];
+				evals[i] = (int)cost[i * 2 + 1];
+			}
+
+			int w = (int)r.x, h = (int)r.y;
+			vector<Color> view(pixelCostCount, BLACK);
+			overlayHeatmap(view, (heatmapMode == HEATMAP_STEPS) ? steps.data() : evals.data(), (int)heatmapMax, 1.0f);
+
+			bool ok = writeCounts(steps.data(), w, h, "heatmap_steps.pgm") && writeCounts(evals.data(), w, h, "heatmap_evals.pgm")
+				&& writeFrame(view, w, h, "heatmap.png", true);
+			cout << (ok ? "HEATMAP: wrote heatmap_steps.pgm, heatmap_evals.pgm, heatmap.png" : "HEATMAP: failed to write") << endl;
+		}
+		dumpHeatmap = false;
+		profiler.end(STAGE_SCENE);
+
+		profiler.begin(STAGE_AA);
 		BeginTextureMode(postRT);
 		BeginShaderMode(aaShader);
 		DrawTexture(sceneRT.texture, 0, 0, WHITE);
 		EndShaderMode();
 		EndTextureMode();
+		profiler.end(STAGE_AA);
 
 		BeginDrawing();		
+			profiler.begin(STAGE_IMGUI);
 			rlImGuiBegin();
 
 				bool open = true;
@@ -517,10 +529,34 @@ int main()
 				{
 					ImGui::SliderFloat("Resolution Scale", &resScale, 0.01f, 1.0f);
 					ImGui::SliderFloat("Smoothness", &k, 0.0f, 2.0f);
+					ImGui::SliderFloat("Over-relaxation", &cam.relaxation, 1.0f, 1.9f);
+					ImGui::Checkbox("Adaptive hit threshold", &cam.adaptiveThreshold);
+					ImGui::Checkbox("Temporal depth reuse", &depthReuse);
+					if (depthReuse) ImGui::SliderFloat("Reuse fraction", &depthReuseFraction, 0.5f, 0.99f);
+					ImGui::Checkbox("Incremental re-render", &incremental);
+					if (incremental) ImGui::Text("Re-rendered: %d%%", dirtyPercent);
+					ImGui::Checkbox("Unrolled scene shader", &unrollScene);
+					if (tileBinner.program != 0) ImGui::Checkbox("Tile binning (compute)", &tileBinning);
+					if (tileBinning && glowIntensity > 0.0f) ImGui::TextUnformatted("Glow is off while binning");
+					ImGui::Text("Scene programs compiled: %d (last %.0f ms)", sceneShaders.compiles, sceneShaders.compileMs);
+					ImGui::Checkbox("Show profiler", &showProfiler);
+					ImGui::Text("Uniforms + shapes uploaded: %d B/frame", uniformBytes);
+					if (trace.capturing) ImGui::Text("Tracing: %d events (F9 to save)", trace.size());
+					ImGui::Checkbox("Count steps", &countSteps);
+					if (countSteps) ImGui::Text("Avg steps/ray: %.2f", avgSteps);
+					ImGui::Combo("Heatmap", &heatmapMode, "Off\0Steps\0SDF evaluations\0");
+					if (heatmapMode != HEATMAP_OFF)
+					{
+						ImGui::SliderFloat("Heatmap max", &heatmapMax, 1.0f, 512.0f);
+						ImGui::SliderFloat("Heatmap blend", &heatmapBlend, 0.0f, 1.0f);
+						if (ImGui::Button("Dump heatmap")) dumpHeatmap = true;
+					}
 
+					ImGui::Checkbox("Soft shadows", &softShadows);
 					ImGui::SliderFloat("Shadow Bias", &shadowBias, 1.0, 200.0);
 					ImGui::SliderFloat("Shadow Softness", &shadowSmoothness, 0.0, 20.0);
 
+					ImGui::SliderFloat("Specular", &specular, 0.0, 1.0);
 					ImGui::SliderFloat("Shininess", &shininess, 3.0, 50.0);
 
 					ImGui::ColorEdit3("Ambient Color", (float*)&bgColor);
@@ -531,12 +567,43 @@ int main()
 					ImGui::SliderFloat("AO step size", &aoStepSize, 0.01, 0.1);
 					ImGui::SliderFloat("AO bias", &aoBias, -2, 2);
 
+					ImGui::Checkbox("Show light", &showLight);
 					ImGui::TextUnformatted("Light Pos");
 					ImGui::SliderFloat("X:", &lightPos.x, -8, 8);
 					ImGui::SliderFloat("Y:", &lightPos.y, -8, 8);
 					ImGui::SliderFloat("Z:", &lightPos.z, -8, 8);
 
-					for (int i = 0; i < shapesLength; i++)
+					ImGui::Separator();
+					ImGui::Text("Shapes: %d", shapesLength);
+					ImGui::SameLine();
+					if (ImGui::Button("Add"))
+					{
+						shapeTypes.push_back(0);
+						shapePositions.push_back({ 0.0f, 0.0f, 0.0f });
+						shapeSizes.push_back({ 1.0f, 1.0f, 1.0f });
+						shapeCols.push_back({ 0.8f, 0.8f, 0.8f });
+					}
+					ImGui::SameLine();
+					if (ImGui::Button("Remove") && !shapeTypes.empty())
+					{
+						shapeTypes.pop_back();
+						shapePositions.pop_back();
+						shapeSizes.pop_back();
+						shapeCols.pop_back();
+					}
+					shapesLength = (int)shapeTypes.size();
+
+					int firstListed = 0;
+					int lastListed = shapesLength;
+					if (shapesLength > maxListedShapes)
+					{
+						ImGui::SliderInt("Edit shape", &editShape, 0, shapesLength - 1);
+						editShape = min(editShape, shapesLength - 1);
+						firstListed = editShape;
+						lastListed = editShape + 1;
+					}
+
+					for (int i = firstListed; i < lastListed; i++)
 					{
 						ImGui::Separator();
 
@@ -592,8 +659,11 @@ int main()
 
 				}
 				ImGui::End();
-			
 
+				if (showProfiler) drawProfilerPanel(profiler, screenX - 340.0f, 10.0f);
+			profiler.end(STAGE_IMGUI);
+
+			profiler.begin(STAGE_PRESENT);
 			ClearBackground(BLACK);
 			BeginShaderMode(aaShader);
 			DrawTexturePro(postRT.texture, Rectangle{ 0, 0, screenX*resScale, screenY*resScale }, Rectangle{ 0, 0, screenX, -screenY }, { 0, 0 }, 0, WHITE);
@@ -603,57 +673,27 @@ int main()
 			DrawFPS(10, 10);
 			rlImGuiEnd();
 		EndDrawing();
-		UnloadRenderTexture(sceneRT);
-		UnloadRenderTexture(postRT);
+		profiler.end(STAGE_PRESENT);
+		profiler.endFrame();
 	}
+	if (trace.capturing) saveTrace(trace, traceCount++);
+
+	targets.clear();
+	cameraBlock.unload();
+	lightingBlock.unload();
+	shapeBlock.unload();
+	shapeBuffer.unload();
+	sceneShaders.unload();
+	tileBinner.unload();
+	rlUnloadShaderBuffer(stepStatsSSBO);
+	if (pixelCostSSBO != 0) rlUnloadShaderBuffer(pixelCostSSBO);
+	depthTargets.unload();
+	profiler.shutdown();
 	rlImGuiShutdown();
 	CloseWindow();
 	return 0;
 }
 
-Vector3 absVec(Vector3 v)
-{
-	return {
-		abs(v.x),
-		abs(v.y),
-		abs(v.z)
-	};
-}
-
-// COMBINE SHAPES
-float min(float a, float b)
-{
-	return (a < b) ? a : b;
-}
-float smin(float a, float b, float k)
-{
-	if (k <= 0.05) { return min(a, b); }
-
-	k *= 1.0;
-	float r = exp2(-a / k) + exp2(-b / k);
-	return -k * log2(r);
-}
-
-float SdfMinOfAll(Shape* shapes[], Vector3 pt, int length, float k)
-{
-	float min = shapes[0]->sdf(pt);
-
-	for (int idx = 1; idx < length; idx++)
-	{
-		min = smin(min, shapes[idx]->sdf(pt), k);
-	}
-
-	return min;
-}
-
-Vector2 oneDtoTwoD(int index, int rowSize)
-{
-	int x = index % rowSize;
-	int y = index / rowSize;
-	return { (float)x, (float)y };
-
-}
-
 Vector3 EulerToDirection(Vector3 eulerRotation)
 {
 	// Convert degrees to radians
@@ -698,7 +738,32 @@ void swapCursor()
 
 }
 
+// shader permutation for the current settings, anything set to nothing is
+// compiled out
+int shaderFeatures()
+{
+	int features = 0;
+	if (softShadows) features |= FEATURE_SHADOWS;
+	if (aoSteps > 0) features |= FEATURE_AO;
+	// glow adds up the march's distances, which binning culls per tile, so
+	// it would stop in hard tile edges around each shape
+	if (glowIntensity > 0.0f && !tileBinning) features |= FEATURE_GLOW;
+	if (specular > 0.0f) features |= FEATURE_SPECULAR;
+	if (showLight) features |= FEATURE_LIGHT_SPHERE;
+	if (tileBinning) features |= FEATURE_TILE_BINNING;
+	return features;
+}
+
 Vector2 resolution(bool isRender)
 {
 	if (isRender) return { screenX*resScale, screenY *resScale}; else return{ screenX, screenY };
-}
\ No newline at end of file
+}
+
+// stop capturing and write trace_<n>.json for chrome://tracing / Perfetto
+void saveTrace(TraceRecorder& trace, int n)
+{
+	trace.stop();
+	string path = "trace_" + to_string(n) + ".json";
+	if (trace.write(path)) cout << "TRACE: wrote " << trace.size() << " events to " << path << endl;
+	else cout << "TRACE: failed to write " << path << endl;
+}
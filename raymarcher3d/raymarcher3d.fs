@@ -1,6 +1,7 @@
 #version 430
 
-out vec4 FragColor;
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out float FragDistance;    // hit distance for depth reuse, > clipEnd = miss
 in vec2 texCoord;
 
 #define SHAPE_TYPE_SPHERE 0
@@ -8,47 +9,130 @@ in vec2 texCoord;
 #define SHAPE_TYPE_TORUS 2
 #define SHAPE_TYPE_MANDELBULB 3
 
-#define MAX_SHAPES 64
+// shading features, all on unless the app compiles a permutation without
+// some (FEATURE_* in scenegen.hpp); off costs nothing at all
+#ifndef FEATURE_SHADOWS
+#define FEATURE_SHADOWS 1
+#endif
+#ifndef FEATURE_AO
+#define FEATURE_AO 1
+#endif
+#ifndef FEATURE_GLOW
+#define FEATURE_GLOW 1
+#endif
+#ifndef FEATURE_SPECULAR
+#define FEATURE_SPECULAR 1
+#endif
+#ifndef FEATURE_LIGHT_SPHERE
+#define FEATURE_LIGHT_SPHERE 1
+#endif
+
+// primary rays march only the shapes tilebin.comp listed for their tile
+#ifndef FEATURE_TILE_BINNING
+#define FEATURE_TILE_BINNING 0
+#endif
+
+// uniform blocks, mirrored by the structs in uniformblocks.hpp (std140).
+// Grouped by how often they change so an unchanged group isn't re-uploaded
+
+// camera, march settings and debug views
+layout(std140, binding = 3) uniform CameraBlock
+{
+    vec3 camOrigin;
+    float camFOV;
+    vec3 camDir;
+    float clipEnd;
+    vec3 prevCamOrigin;     // temporal depth reuse: last frame's camera
+    float hitThreshold;
+    vec3 prevCamDir;
+    float relaxation;       // sphere tracing over-relaxation, 1 = plain
+    vec2 iResolution;
+    int countSteps;         // accumulate into StepStats
+    int adaptiveThreshold;  // grow the hit threshold with the pixel footprint
+    int depthReuse;
+    float depthReuseFraction;
+    int heatmapMode;        // cost heatmap (heatmap.hpp): 0 off, 1 steps, 2 scene SDF evaluations
+    float heatmapMax;       // count drawn red
+    float heatmapBlend;
+};
 
-struct Shape{
-    int type;
+layout(std140, binding = 4) uniform LightingBlock
+{
+    vec3 lightPos;
+    float sb;
+    vec3 lightColor;
+    float shininess;
+    vec3 bgColor;
+    float glowIntensity;
+    vec3 glowCol;
+    float shadowSmoothness;
+    int aoSteps;
+    float aoStepSize;
+    float aoBias;
+    float specularStrength;
+};
+
+layout(std140, binding = 5) uniform ShapeBlock
+{
+    int shapeCount;
+    float k;
+};
+
+// the scene, GpuShape in shapebuffer.hpp (std430). Sized by capacity, only
+// the first shapeCount are live
+struct ShapeData
+{
     vec3 origin;
-    vec3 values;
+    int type;
+    vec3 size;
+    vec3 col;
+};
+
+layout(std430, binding = 0) readonly buffer Shapes
+{
+    ShapeData shapes[];
+};
+
+// last frame's FragDistance for depth reuse
+uniform sampler2D prevHitDistance;
+
+// steps per ray, summed over the frame when countSteps is set
+layout(std430, binding = 1) buffer StepStats
+{
+    uint totalSteps;
+    uint totalRays;
 };
 
-uniform vec2 iResolution;
-uniform float iTime;
-
-uniform int shapeCount;
-
-uniform int shapeTypes[MAX_SHAPES];
-uniform vec3 shapeOrigins[MAX_SHAPES];
-uniform vec3 shapeSizes[MAX_SHAPES];
-uniform vec3 shapeCols[MAX_SHAPES];
-
-uniform vec3 camOrigin;
-uniform vec3 camDir;
-uniform float camFOV;
-uniform float clipEnd;
-uniform float hitThreshold;
-
-// debug parameters
-uniform vec3 lightPos;
-uniform float sb;
-uniform float k;
-uniform vec3 lightColor;
-uniform vec3 bgColor;
-uniform float shininess;
-uniform vec3 glowCol;
-uniform float glowIntensity;
-uniform float shadowSmoothness;
-uniform int aoSteps;
-uniform float aoStepSize;
-uniform float aoBias;
+// per pixel (steps, scene SDF evaluations), row 0 at the top like the CPU
+// ray buffer, written while heatmapMode is set
+layout(std430, binding = 2) buffer PixelCost
+{
+    uvec2 pixelCost[];
+};
+
+#if FEATURE_TILE_BINNING
+// as tilebin.comp: shapes covering each TILE_SIZE pixel tile, row 0 at the
+// top, in shape order. A count past TILE_MAX_SHAPES means the list is cut
+#define TILE_SIZE 16
+#define TILE_MAX_SHAPES 128
+
+layout(std430, binding = 3) readonly buffer TileCounts
+{
+    uint tileCount[];
+};
+
+layout(std430, binding = 4) readonly buffer TileShapes
+{
+    uint tileShape[];
+};
+
+uint tileBase = 0u;     // this pixel's list in tileShape
+uint tileShapes = 0u;   // its length, > TILE_MAX_SHAPES for every shape
+#endif
 
 float shadowBias = hitThreshold * sb;
 
-Shape shapes[MAX_SHAPES];
+int sdfEvals = 0;   // sceneSDF calls for this pixel
 
 //--------------------------------------SHAPE SDFS
 
@@ -132,56 +216,90 @@ vec4 combine(float dstA, float dstB, vec3 colA, vec3 colB, int operation, float
     return vec4(col, dst);
 }
 
-float getSdf(Shape s, vec3 pt)
+float getSdf(ShapeData s, vec3 pt)
 {
     if(s.type == SHAPE_TYPE_SPHERE)
     {
-        return sdSphere(s.origin, pt, s.values.x);
+        return sdSphere(s.origin, pt, s.size.x);
     }
     else if(s.type == SHAPE_TYPE_BOX)
     {
-        return sdBox(s.origin, pt, s.values);
+        return sdBox(s.origin, pt, s.size);
     }
     else if(s.type == SHAPE_TYPE_TORUS)
     {
-        return sdTorus(s.origin, pt, s.values.xy);
+        return sdTorus(s.origin, pt, s.size.xy);
     }
     else if(s.type == SHAPE_TYPE_MANDELBULB)
     {
-        return sdfMandelbulb(s.origin, pt, s.values);
+        return sdfMandelbulb(s.origin, pt, s.size);
     }
 
     return 1e6;
 }
 
-vec4 sceneSDF(vec3 pt)
+// scenegen.cpp replaces this line with an unrolled copy of the loop below
+// for one scene topology, and defines SCENE_UNROLLED
+//@scene
+
+// every shape blended in, light is also min'd in after each one (1e6 = none)
+vec4 shapesSDF(vec3 pt, float light)
 {
+#ifdef SCENE_UNROLLED
+    return unrolledShapesSDF(pt, light);
+#else
     float totalDist = 1e6;
     vec3 totalCol = vec3(0, 0, 0);
     for(int i = 0; i < shapeCount; ++i)
     {
         float distance = getSdf(shapes[i], pt);
-        vec3 col = shapeCols[i];
+        vec3 col = shapes[i].col;
         vec4 data = combine(totalDist, distance, totalCol, col, 0, k);
         totalCol = data.xyz;
-        totalDist = data.w;
+        totalDist = min(data.w, light);
     }
 
     return vec4(totalCol, totalDist);
+#endif
 }
-vec4 sceneSDFwithLight(vec3 pt)
+
+// shapesSDF for points on this pixel's primary ray. A shape not binned to
+// the tile is more than the blend reach off every such point, so leaving it
+// out can't change where the ray hits. Shading moves off the ray and uses
+// every shape
+vec4 marchShapesSDF(vec3 pt, float light)
 {
-    float totalDist = 1e6;
-    vec3 totalCol = vec3(0, 0, 0);
-    for(int i = 0; i < shapeCount; ++i)
+#if FEATURE_TILE_BINNING
+    if (tileShapes <= uint(TILE_MAX_SHAPES))
     {
-        float distance = getSdf(shapes[i], pt);
-        vec3 col = shapeCols[i];
-        vec4 data = combine(totalDist, distance, totalCol, col, 0, k);
-        data.w = min(data.w, sdSphere(-lightPos, pt, 0.1f));
-        totalCol = data.xyz;
-        totalDist = data.w;
+        float totalDist = 1e6;
+        vec3 totalCol = vec3(0, 0, 0);
+        for(uint j = 0u; j < tileShapes; ++j)
+        {
+            ShapeData s = shapes[tileShape[tileBase + j]];
+            vec4 data = combine(totalDist, getSdf(s, pt), totalCol, s.col, 0, k);
+            totalCol = data.xyz;
+            totalDist = min(data.w, light);
+        }
+
+        return vec4(totalCol, min(totalDist, light));
     }
+#endif
+    return shapesSDF(pt, light);
+}
+
+vec4 sceneSDF(vec3 pt)
+{
+    sdfEvals++;
+    return shapesSDF(pt, 1e6);
+}
+vec4 sceneSDFwithLight(vec3 pt)
+{
+#if FEATURE_LIGHT_SPHERE
+    sdfEvals++;
+    vec4 data = marchShapesSDF(pt, sdSphere(-lightPos, pt, 0.1f));
+    float totalDist = data.w;
+    vec3 totalCol = data.xyz;
 
     // light was hit
     if(sdSphere(-lightPos, pt, 0.1f) <= hitThreshold)
@@ -190,6 +308,10 @@ vec4 sceneSDFwithLight(vec3 pt)
     }
 
     return vec4(totalCol, totalDist);
+#else
+    sdfEvals++;
+    return marchShapesSDF(pt, 1e6);
+#endif
 }
 
 vec3 getNormal(vec3 pt)
@@ -298,62 +420,168 @@ vec3 camUp()
 }
 
 
-//--------------------------------------MAIN
-void main()
+vec3 rayDir(vec3 forward, vec3 right, vec3 up, vec2 fragCoord, float halfWidth, float halfHeight)
+{
+    float u = (fragCoord.x + 0.5f) / iResolution.x;
+    float v = (fragCoord.y + 0.5f) / iResolution.y;
+
+    float x = (2.0f * u - 1.0f) * halfWidth;
+    float y = (1.0f - 2.0f * v) * halfHeight;
+
+    return normalize(forward + (right * x) + (up * y));
+}
+
+//--------------------------------------DEPTH REUSE
+// push this ray's guess point (last frame's distance at this pixel) into the
+// last camera, then start at a fraction of the distance to the nearest of the
+// 3x3 old hits around it. 0 = march from the camera
+float reprojectedStart(vec3 dir, float halfWidth, float halfHeight)
 {
-    // SETUP SHAPES
-    for(int i = 0; i < shapeCount; i++)
+    ivec2 size = ivec2(iResolution);
+    float guess = texelFetch(prevHitDistance, ivec2(gl_FragCoord.xy), 0).r;
+    if (guess > clipEnd) return 0.0;
+
+    vec3 forward = normalize(prevCamDir);
+    vec3 right = normalize(cross(worldUp(), forward));
+    vec3 up = cross(forward, right);
+
+    vec3 v = camOrigin + dir * guess - prevCamOrigin;
+    float z = dot(v, forward);
+    if (z <= 0.0) return 0.0;
+
+    // inverse of rayDir
+    float u = (dot(v, right) / z / halfWidth + 1.0) * 0.5;
+    float w = (1.0 - dot(v, up) / z / halfHeight) * 0.5;
+    ivec2 texel = ivec2(floor(vec2(u, w) * iResolution - 0.5));
+
+    float nearest = 1e30;
+    for (int j = -1; j <= 1; j++)
     {
-        shapes[i].origin = shapeOrigins[i];
-        shapes[i].type = shapeTypes[i];
-        shapes[i].values = shapeSizes[i];
+        for (int i = -1; i <= 1; i++)
+        {
+            ivec2 tap = texel + ivec2(i, j);
+            if (any(lessThan(tap, ivec2(0))) || any(greaterThanEqual(tap, size))) return 0.0;
+
+            // a miss next to the hit is a silhouette we might now see past
+            float d = texelFetch(prevHitDistance, tap, 0).r;
+            if (d > clipEnd) return 0.0;
+
+            vec3 hit = prevCamOrigin + rayDir(forward, right, up, vec2(tap) + 0.5, halfWidth, halfHeight) * d;
+            nearest = min(nearest, distance(hit, camOrigin));
+        }
     }
+    return nearest * depthReuseFraction;
+}
+
+//--------------------------------------HEATMAP
+// same ramp as heatColor() in heatmap.cpp
+vec3 heatColor(float t)
+{
+    t = saturate(t);
+    return clamp(1.5 - abs(4.0 * t - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);
+}
+
+// record this pixel's cost and tint the colour by it
+vec4 applyHeatmap(vec4 color, int steps)
+{
+    if (heatmapMode == 0) return color;
+
+    ivec2 px = ivec2(gl_FragCoord.xy);
+    pixelCost[px.y * int(iResolution.x) + px.x] = uvec2(steps, sdfEvals);
+
+    float value = (heatmapMode == 1) ? float(steps) : float(sdfEvals);
+    return vec4(mix(color.rgb, heatColor(value / heatmapMax), heatmapBlend), 1.0);
+}
 
+//--------------------------------------MAIN
+void main()
+{
     // INIT RAY
     float aspect = iResolution.x / iResolution.y;
     float halfHeight = tan(camFOV / 2.0f);
     float halfWidth = aspect * halfHeight;
 
-    float u = (gl_FragCoord.x + 0.5f) / iResolution.x;
-    float v = (gl_FragCoord.y + 0.5f) / iResolution.y;
-
-    float x = (2.0f * u - 1.0f) * halfWidth;
-    float y = (1.0f - 2.0f * v) * halfHeight;
-
+#if FEATURE_TILE_BINNING
+    ivec2 tile = ivec2(gl_FragCoord.xy) / TILE_SIZE;
+    int tileIndex = tile.y * ((int(iResolution.x) + TILE_SIZE - 1) / TILE_SIZE) + tile.x;
+    tileBase = uint(tileIndex * TILE_MAX_SHAPES);
+    tileShapes = tileCount[tileIndex];
+#endif
 
     // init ray values
-    vec3 dir = normalize(camForward() + (camRight() * x) + (camUp() * y));
-    vec3 origin = camOrigin;
-    float totalDistance = 0.0;
+    vec3 dir = rayDir(camForward(), camRight(), camUp(), gl_FragCoord.xy, halfWidth, halfHeight);
+    float totalDistance = (depthReuse != 0) ? reprojectedStart(dir, halfWidth, halfHeight) : 0.0;
+    float startDistance = totalDistance;
+    vec3 origin = camOrigin + dir * totalDistance;
     int stepsTaken = 0;
 
     // MARCH RAY
+    // over-relaxed sphere tracing (Keinert et al. 2014): step relaxation * length.
+    // If the unbounding spheres of this sample and the last don't overlap we
+    // skipped past a surface, so go back and step normally from then on
     float length = hitThreshold;
     vec3 localCol = vec3(0.0, 0.0, 0.0);
     vec4 info;
     float glowAcc = 0;
-    while(totalDistance < clipEnd && length >= hitThreshold)
+    float omega = relaxation;
+    float pixelCone = (adaptiveThreshold != 0) ? halfHeight / iResolution.y : 0.0;
+    float prevDistance = totalDistance;  // a seeded ray starts at its seed, not the camera
+    float prevLength = 0.0;
+    while(totalDistance < clipEnd)
     {
         info = sceneSDFwithLight(origin);
         if(info.w == 3.99)
         {
-            FragColor = vec4(1.0);
+            FragColor = applyHeatmap(vec4(1.0), stepsTaken);
+            FragDistance = totalDistance;
             return;
         }
 
         length = info.w;
+        stepsTaken++;
 
+        // a seed inside geometry is no good, march from the camera instead
+        if(length < 0.0 && startDistance > 0.0 && totalDistance == startDistance)
+        {
+            totalDistance = startDistance = prevDistance = 0.0;
+            origin = camOrigin;
+            continue;
+        }
+
+        if(omega > 1.0 && (length < 0.0 || length + prevLength < totalDistance - prevDistance))
+        {
+            totalDistance = prevDistance + prevLength;
+            origin = camOrigin + dir * totalDistance;
+            omega = 1.0;
+            continue;
+        }
+
+#if FEATURE_GLOW
         // add glow value
         glowAcc += pow(1e-3 / max(length, 1e-6), glowIntensity);
+#endif
+
+        if(length < max(hitThreshold, totalDistance * pixelCone)) break;
 
         // march ray once
-        origin += dir * length;
-        totalDistance += length;
-        stepsTaken++;
+        prevDistance = totalDistance;
+        prevLength = length;
+        totalDistance += length * omega;
+        origin = camOrigin + dir * totalDistance;
+    }
+
+    if(countSteps != 0)
+    {
+        atomicAdd(totalSteps, uint(stepsTaken));
+        atomicAdd(totalRays, 1u);
     }
 
     vec3 color;
+#if FEATURE_GLOW
     vec4 glow = vec4(glowCol, 1.0) * glowIntensity * glowAcc;
+#else
+    vec4 glow = vec4(0.0);
+#endif
 
     // ray has finished! get ray data and set color
     if (totalDistance > clipEnd)
@@ -373,19 +601,31 @@ void main()
         // SHADING DATA
         float lighting = saturate(dot(normal, lightDir(origin)));
 
+#if FEATURE_SHADOWS
         vec3 offsetPos = origin + normal * shadowBias;
         vec3 shadowLightDir = lightDir(offsetPos);
         float dstToLight = distance(offsetPos, lightPos);
         float shadow = softShadow(offsetPos, shadowLightDir, shadowBias, dstToLight);
+#else
+        float shadow = 1.0;
+#endif
 
         vec3 ambient = phongAmbient();
 
-        vec3 specular = phongSpecular(getNormal(origin), origin);
+#if FEATURE_SPECULAR
+        vec3 specular = phongSpecular(normal, origin) * specularStrength;
+#else
+        vec3 specular = vec3(0.0);
+#endif
         
 
         float totalLight = min(lighting, shadow);
 
+#if FEATURE_AO
         float AO = ambientOcclusion(origin, normal);
+#else
+        float AO = 1.0;
+#endif
         glow *= AO;
         //AO = saturate(AO);
 
@@ -399,5 +639,6 @@ void main()
         //if(AO < 0) color = vec3(0.0, 1.0, 0.0);
     }   
 
-    FragColor = vec4(color, 1) + glow;
+    FragColor = applyHeatmap(vec4(color, 1) + glow, stepsTaken);
+    FragDistance = totalDistance;
 }
\ No newline at end of file
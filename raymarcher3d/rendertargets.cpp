@@ -0,0 +1,90 @@
+#include "rendertargets.hpp"
+#include "rlgl.h"
+
+using namespace std;
+
+// LoadRenderTexture is always RGBA8, other formats swap in their own colour texture
+static RenderTexture2D loadTarget(int width, int height, int format)
+{
+	RenderTexture2D target = LoadRenderTexture(width, height);
+
+	if (format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 && target.id != 0)
+	{
+		rlUnloadTexture(target.texture.id);
+		target.texture.id = rlLoadTexture(nullptr, width, height, format, 1);
+		target.texture.format = format;
+		rlFramebufferAttach(target.id, target.texture.id, RL_ATTACHMENT_COLOR_CHANNEL0, RL_ATTACHMENT_TEXTURE2D, 0);
+	}
+	return target;
+}
+
+RenderTexture2D RenderTargetPool::acquire(int width, int height, int format)
+{
+	for (int i = 0; i < entries.size(); i++)
+	{
+		Entry& e = entries[i];
+		if (!e.inUse && e.width == width && e.height == height && e.format == format)
+		{
+			e.inUse = true;
+			return e.target;
+		}
+	}
+
+	Entry e;
+	e.target = loadTarget(width, height, format);
+	e.width = width;
+	e.height = height;
+	e.format = format;
+	e.inUse = true;
+	e.releasedAt = 0.0;
+	entries.push_back(e);
+	created++;
+	return e.target;
+}
+
+void RenderTargetPool::release(const RenderTexture2D& target)
+{
+	int idle = 0;
+	int oldest = -1;
+
+	for (int i = 0; i < entries.size(); i++)
+	{
+		Entry& e = entries[i];
+		if (e.target.id == target.id && e.inUse)
+		{
+			e.inUse = false;
+			e.releasedAt = lastTrim;
+		}
+		if (!e.inUse)
+		{
+			idle++;
+			if (oldest < 0 || e.releasedAt < entries[oldest].releasedAt) oldest = i;
+		}
+	}
+
+	if (idle > maxIdle) freeEntry(oldest);
+}
+
+void RenderTargetPool::trim(double now)
+{
+	lastTrim = now;
+
+	for (int i = (int)entries.size() - 1; i >= 0; i--)
+	{
+		if (!entries[i].inUse && now - entries[i].releasedAt > idleSeconds) freeEntry(i);
+	}
+}
+
+void RenderTargetPool::clear()
+{
+	for (int i = (int)entries.size() - 1; i >= 0; i--)
+	{
+		freeEntry(i);
+	}
+}
+
+void RenderTargetPool::freeEntry(int index)
+{
+	UnloadRenderTexture(entries[index].target);
+	entries.erase(entries.begin() + index);
+}
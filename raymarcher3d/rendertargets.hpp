@@ -0,0 +1,45 @@
+#ifndef RENDERTARGETS_HPP
+#define RENDERTARGETS_HPP
+
+#include "raylib.h"
+#include <vector>
+
+// Render target pool keyed by size and colour format.
+//
+// acquire() hands out an idle target with a matching key or creates one;
+// release() returns it without freeing the GPU memory, so going back to a
+// recent resolution (dragging the resolution slider, toggling a pass) reuses
+// the old framebuffer. trim() frees targets that have sat idle for longer
+// than idleSeconds, and never more than maxIdle idle targets are kept.
+// Contents are undefined after acquire().
+
+class RenderTargetPool
+{
+public:
+	double idleSeconds = 2.0;
+	int maxIdle = 8;
+
+	RenderTexture2D acquire(int width, int height, int format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+	void release(const RenderTexture2D& target);
+	void trim(double now);		// call once a frame with GetTime()
+	void clear();				// frees everything, in use or not
+
+	int allocated() const { return (int)entries.size(); }
+	int created = 0;			// over the pool's lifetime
+
+private:
+	struct Entry
+	{
+		RenderTexture2D target;
+		int width, height, format;
+		bool inUse;
+		double releasedAt;
+	};
+
+	std::vector<Entry> entries;
+	double lastTrim = 0.0;
+
+	void freeEntry(int index);
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "scenegen.hpp"
+#include "engine.hpp"
+#include "programcache.hpp"
+#include "rlgl.h"
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+static const char* SCENE_MARKER = "//@scene";
+
+unsigned long long sceneTopologyHash(const int types[], int count)
+{
+	// FNV-1a over the count and the type list
+	unsigned long long hash = 14695981039346656037ull;
+	for (int i = -1; i < count; i++)
+	{
+		unsigned int value = (i < 0) ? (unsigned int)count : (unsigned int)types[i];
+		for (int b = 0; b < 4; b++)
+		{
+			hash ^= (value >> (b * 8)) & 0xFF;
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+// GLSL distance to shapes[i], as getSdf() in raymarcher3d.fs
+static string shapeCall(int type, int i)
+{
+	string s = "shapes[" + to_string(i) + "]";
+	switch (type)
+	{
+		case SHAPE_TYPE_SPHERE: return "sdSphere(" + s + ".origin, pt, " + s + ".size.x)";
+		case SHAPE_TYPE_BOX: return "sdBox(" + s + ".origin, pt, " + s + ".size)";
+		case SHAPE_TYPE_TORUS: return "sdTorus(" + s + ".origin, pt, " + s + ".size.xy)";
+		case SHAPE_TYPE_MANDELBULB: return "sdfMandelbulb(" + s + ".origin, pt, " + s + ".size)";
+		default: return "1e6";
+	}
+}
+
+string generateSceneShader(const string& source, const int types[], int count)
+{
+	size_t marker = source.find(SCENE_MARKER);
+	if (marker == string::npos) return string();
+
+	string code;
+	code += "#define SCENE_UNROLLED\n";
+	code += "// generated by scenegen.cpp for " + to_string(count) + " shapes\n";
+	code += "vec4 unrolledShapesSDF(vec3 pt, float light)\n{\n";
+	code += "    float totalDist = 1e6;\n";
+	code += "    vec3 totalCol = vec3(0, 0, 0);\n";
+	code += "    vec4 data;\n";
+
+	for (int i = 0; i < count; i++)
+	{
+		string s = "shapes[" + to_string(i) + "]";
+		code += "    data = combine(totalDist, " + shapeCall(types[i], i) + ", totalCol, " + s + ".col, 0, k);\n";
+		code += "    totalCol = data.xyz;\n";
+		code += "    totalDist = min(data.w, light);\n";
+	}
+
+	code += "    return vec4(totalCol, totalDist);\n}\n";
+
+	return source.substr(0, marker) + code + source.substr(marker + string(SCENE_MARKER).size());
+}
+
+string defineFeatures(const string& source, int features)
+{
+	static const char* names[] = { "FEATURE_SHADOWS", "FEATURE_AO", "FEATURE_GLOW", "FEATURE_SPECULAR", "FEATURE_LIGHT_SPHERE", "FEATURE_TILE_BINNING" };
+
+	string defines;
+	for (int i = 0; i < 6; i++)
+	{
+		defines += string("#define ") + names[i] + ((features & (1 << i)) ? " 1\n" : " 0\n");
+	}
+
+	size_t line = source.find('\n');
+	if (line == string::npos) return source;
+	return source.substr(0, line + 1) + defines + source.substr(line + 1);
+}
+
+bool SceneShaderCache::load(const char* path)
+{
+	char* text = LoadFileText(path);
+	source = text ? text : "";
+	UnloadFileText(text);
+
+	generic = compile(source, 0, FEATURE_ALL, false);
+	return generic.shader.id != 0;
+}
+
+void SceneShaderCache::unload()
+{
+	for (int i = 0; i < programs.size(); i++)
+	{
+		if (programs[i].shader.id != generic.shader.id) UnloadShader(programs[i].shader);
+	}
+	programs.clear();
+
+	if (generic.shader.id != 0) UnloadShader(generic.shader);
+	generic = SceneProgram();
+}
+
+SceneProgram SceneShaderCache::compile(const string& code, unsigned long long topology, int features, bool unrolled)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	SceneProgram program;
+	program.shader = binaries ? binaries->load(nullptr, code.c_str()) : LoadShaderFromMemory(nullptr, code.c_str());
+	program.topology = topology;
+	program.features = features;
+	program.requested = features;
+	program.unrolled = unrolled;
+
+	// raylib hands back its default shader when compiling or linking fails
+	if (program.shader.id == rlGetShaderIdDefault()) program.shader.id = 0;
+	if (program.shader.id != 0) program.prevHitDistanceLoc = GetShaderLocation(program.shader, "prevHitDistance");
+
+	compileMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	compiles++;
+	return program;
+}
+
+const SceneProgram& SceneShaderCache::get(const int types[], int count, int features, bool unroll)
+{
+	// binning is for scenes too big to unroll, the tile lists need the loop
+	unroll = unroll && count <= maxUnrolled && !(features & FEATURE_TILE_BINNING);
+	if (generic.shader.id == 0 || (!unroll && features == FEATURE_ALL)) return generic;
+
+	unsigned long long topology = unroll ? sceneTopologyHash(types, count) : 0;
+	useCount++;
+
+	for (int i = 0; i < programs.size(); i++)
+	{
+		if (programs[i].topology != topology || programs[i].requested != features) continue;
+
+		programs[i].lastUsed = useCount;
+		return programs[i];
+	}
+
+	if ((int)programs.size() >= maxPrograms)
+	{
+		int oldest = 0;
+		for (int i = 1; i < programs.size(); i++)
+		{
+			if (programs[i].lastUsed < programs[oldest].lastUsed) oldest = i;
+		}
+		if (programs[oldest].shader.id != generic.shader.id) UnloadShader(programs[oldest].shader);
+		programs.erase(programs.begin() + oldest);
+	}
+
+	string code = unroll ? generateSceneShader(source, types, count) : source;
+	SceneProgram program = compile(defineFeatures(code, features), topology, features, unroll);
+	if (program.shader.id == 0)
+	{
+		// keep the failure cached too, so it isn't recompiled every frame
+		cerr << "SCENEGEN: shader variant failed to compile, using the generic one" << endl;
+		program.shader = generic.shader;
+		program.prevHitDistanceLoc = generic.prevHitDistanceLoc;
+		program.features = generic.features;
+		program.unrolled = false;
+	}
+	program.lastUsed = useCount;
+	programs.push_back(program);
+	return programs.back();
+}
@@ -0,0 +1,78 @@
+#ifndef SCENEGEN_HPP
+#define SCENEGEN_HPP
+
+#include "raylib.h"
+#include <string>
+#include <vector>
+
+// Scene-specialised variants of raymarcher3d.fs.
+//
+// The generic shader loops over shapeCount and branches on each shape's
+// type in getSdf, per SDF evaluation. For a given topology (the shape count
+// and the type of each shape) the generator writes that loop out unrolled,
+// calling each shape's SDF directly. Parameters are still read from the
+// shape buffer, so moving, resizing or recolouring a shape keeps the same
+// program; adding, removing or retyping one needs another, compiled on
+// first use and kept for when the scene goes back to that topology.
+//
+// Each program is also built for a set of shading features. A feature that
+// is switched off in the UI is compiled out (#define FEATURE_* 0) rather
+// than skipped at run time, so its cost goes away entirely.
+
+// named as the GLSL defines
+enum SceneFeature
+{
+	FEATURE_SHADOWS = 1,		// softShadow() towards the light
+	FEATURE_AO = 2,				// ambientOcclusion()
+	FEATURE_GLOW = 4,			// glow accumulated per march step
+	FEATURE_SPECULAR = 8,
+	FEATURE_LIGHT_SPHERE = 16,	// light drawn as a sphere, sceneSDFwithLight
+	FEATURE_ALL = 31,			// every shading feature
+	FEATURE_TILE_BINNING = 32	// primary rays march their tile's shapes (tilebinning.hpp)
+};
+
+struct SceneProgram
+{
+	Shader shader = {};
+	int prevHitDistanceLoc = -1;
+	unsigned long long topology = 0;	// 0 for the looping shader
+	int features = FEATURE_ALL;			// what the shader runs
+	int requested = FEATURE_ALL;		// what it was built for, the cache key
+	bool unrolled = false;
+	long long lastUsed = 0;
+};
+
+class ProgramCache;
+
+class SceneShaderCache
+{
+public:
+	ProgramCache* binaries = nullptr;	// on-disk program cache, or compile every launch
+	int maxPrograms = 32;		// least recently used are unloaded past this
+	int maxUnrolled = 256;		// bigger scenes stay on the generic shader
+
+	SceneProgram generic;		// the looping shader as written, every feature on
+	int compiles = 0;
+	double compileMs = 0.0;		// last compile
+
+	bool load(const char* path);	// after InitWindow; false if the generic shader fails
+	void unload();
+
+	// program for these features, unrolled for this topology if asked and
+	// it can be, else looping; valid until the next get()
+	const SceneProgram& get(const int types[], int count, int features, bool unroll);
+
+private:
+	std::string source;
+	std::vector<SceneProgram> programs;
+	long long useCount = 0;
+
+	SceneProgram compile(const std::string& code, unsigned long long topology, int features, bool unrolled);
+};
+
+// Function declarations
+unsigned long long sceneTopologyHash(const int types[], int count);
+std::string generateSceneShader(const std::string& source, const int types[], int count);	// empty if source has no //@scene line
+std::string defineFeatures(const std::string& source, int features);	// after the #version line
+
+#endif
@@ -0,0 +1,128 @@
+#include "scenestore.hpp"
+#include "engine.hpp"
+#include <math.h>
+
+using namespace std;
+
+void SceneStore::clear()
+{
+	spheres.clear();
+	boxes.clear();
+	tori.clear();
+	sphereCols.clear();
+	boxCols.clear();
+	torusCols.clear();
+	bulbs.clear();
+	bulbCols.clear();
+}
+
+int SceneStore::build(Shape* shapes[], int count)
+{
+	clear();
+
+	for (int i = 0; i < count; i++)
+	{
+		Shape* s = shapes[i];
+		Vector3 o = s->origin;
+
+		switch (s->type)
+		{
+			case SHAPE_TYPE_SPHERE:
+				spheres.push_back({ o.x, o.y, o.z, ((Sphere*)s)->radius });
+				sphereCols.push_back(s->col);
+				break;
+			case SHAPE_TYPE_BOX:
+			{
+				Vector3 l = ((Box*)s)->lengths;
+				boxes.push_back({ o.x, o.y, o.z, l.x, l.y, l.z });
+				boxCols.push_back(s->col);
+				break;
+			}
+			case SHAPE_TYPE_TORUS:
+			{
+				Vector2 v = ((Torus*)s)->torusValues;
+				tori.push_back({ o.x, o.y, o.z, v.x, v.y });
+				torusCols.push_back(s->col);
+				break;
+			}
+			case SHAPE_TYPE_MANDELBULB:
+			{
+				Mandelbulb* m = (Mandelbulb*)s;
+				bulbs.push_back({ o.x, o.y, o.z, m->iterations, m->scale, m->power });
+				bulbCols.push_back(s->col);
+				break;
+			}
+		}
+	}
+	return size();
+}
+
+static inline float sphereDist(const SphereRecord& r, Vector3 p)
+{
+	float x = p.x - r.ox, y = p.y - r.oy, z = p.z - r.oz;
+	return sqrtf(x * x + y * y + z * z) - r.radius;
+}
+
+static inline float boxDist(const BoxRecord& r, Vector3 p)
+{
+	float qx = fabsf(p.x - r.ox) - r.sx;
+	float qy = fabsf(p.y - r.oy) - r.sy;
+	float qz = fabsf(p.z - r.oz) - r.sz;
+
+	float ox = fmaxf(qx, 0.0f), oy = fmaxf(qy, 0.0f), oz = fmaxf(qz, 0.0f);
+	return sqrtf(ox * ox + oy * oy + oz * oz) + fminf(fmaxf(qx, fmaxf(qy, qz)), 0.0f);
+}
+
+static inline float torusDist(const TorusRecord& r, Vector3 p)
+{
+	float x = p.x - r.ox, y = p.y - r.oy, z = p.z - r.oz;
+	float qx = sqrtf(x * x + z * z) - r.major;
+	return sqrtf(qx * qx + y * y) - r.minor;
+}
+
+static inline float bulbDist(const MandelbulbRecord& r, Vector3 p)
+{
+	return mandelbulbDE({ p.x - r.ox, p.y - r.oy, p.z - r.oz }, r.iterations, r.scale, r.power);
+}
+
+float SceneStore::sdf(Vector3 pt, float k) const
+{
+	if (size() == 0) return 1e6f;
+
+	SminAccumulator acc = { k };
+
+	for (int i = 0; i < spheres.size(); i++) acc.add(sphereDist(spheres[i], pt));
+	for (int i = 0; i < boxes.size(); i++) acc.add(boxDist(boxes[i], pt));
+	for (int i = 0; i < tori.size(); i++) acc.add(torusDist(tori[i], pt));
+	for (int i = 0; i < bulbs.size(); i++) acc.add(bulbDist(bulbs[i], pt));
+
+	return acc.result();
+}
+
+Vector3 SceneStore::closestCol(Vector3 pt) const
+{
+	float best = 1e30f;
+	Vector3 col = { 1.0f, 1.0f, 1.0f };
+
+	for (int i = 0; i < spheres.size(); i++)
+	{
+		float d = sphereDist(spheres[i], pt);
+		if (d < best) { best = d; col = sphereCols[i]; }
+	}
+	for (int i = 0; i < boxes.size(); i++)
+	{
+		float d = boxDist(boxes[i], pt);
+		if (d < best) { best = d; col = boxCols[i]; }
+	}
+	for (int i = 0; i < tori.size(); i++)
+	{
+		float d = torusDist(tori[i], pt);
+		if (d < best) { best = d; col = torusCols[i]; }
+	}
+	for (int i = 0; i < bulbs.size(); i++)
+	{
+		float d = bulbDist(bulbs[i], pt);
+		if (d < best) { best = d; col = bulbCols[i]; }
+	}
+	return col;
+}
@@ -0,0 +1,62 @@
+#ifndef SCENESTORE_HPP
+#define SCENESTORE_HPP
+
+#include "raylib.h"
+#include <vector>
+
+class Shape;
+
+// Flat scene storage: one POD record per primitive, grouped by type, so the
+// scene SDF is a tight loop per type with no virtual calls.
+//
+// smin() is -k*log2(sum 2^(-d/k)), which doesn't depend on the order shapes
+// are combined in, so regrouping by type gives the same distance as
+// SdfMinOfAll.
+
+struct SphereRecord
+{
+	float ox, oy, oz;
+	float radius;
+};
+
+struct BoxRecord
+{
+	float ox, oy, oz;
+	float sx, sy, sz;
+};
+
+struct TorusRecord
+{
+	float ox, oy, oz;
+	float major, minor;
+};
+
+struct MandelbulbRecord
+{
+	float ox, oy, oz;
+	float iterations, scale, power;
+};
+
+class SceneStore
+{
+public:
+	std::vector<SphereRecord> spheres;
+	std::vector<BoxRecord> boxes;
+	std::vector<TorusRecord> tori;
+	std::vector<MandelbulbRecord> bulbs;
+
+	// colours, parallel to the record arrays
+	std::vector<Vector3> sphereCols;
+	std::vector<Vector3> boxCols;
+	std::vector<Vector3> torusCols;
+	std::vector<Vector3> bulbCols;
+
+	void clear();
+	int build(Shape*[], int);		// returns number of shapes stored
+	int size() const { return (int)(spheres.size() + boxes.size() + tori.size() + bulbs.size()); }
+
+	float sdf(Vector3 pt, float k) const;			// same as SdfMinOfAll
+	Vector3 closestCol(Vector3 pt) const;			// colour of the nearest primitive
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef SCENETEMPLATES_HPP
+#define SCENETEMPLATES_HPP
+
+#include "raylib.h"
+#include <math.h>
+
+// Compile-time scenes: primitives and their smooth unions as one template
+// expression, so the compiler can inline the whole scene SDF into
+// Cam3d::marchRayWith. Results match the runtime Shape classes combined with
+// SdfMinOfAll in the same order, e.g.
+//
+//   auto scene = smoothUnion(smoothUnion(SphereX(a, 1.0f), BoxX(b, s), k), TorusX(c, t), k);
+//   cam.marchRayWith(idx, scene);
+
+namespace sdfx
+{
+	// same as smin() in engine.cpp, inline so it can fuse into the march loop
+	inline float sminX(float a, float b, float k)
+	{
+		if (k <= 0.05) { return (a < b) ? a : b; }
+
+		float r = exp2f(-a / k) + exp2f(-b / k);
+		return -k * log2f(r);
+	}
+
+	struct SphereX
+	{
+		Vector3 origin;
+		float radius;
+
+		constexpr SphereX(Vector3 origin, float radius) : origin(origin), radius(radius) {}
+
+		float operator()(Vector3 pt) const
+		{
+			float x = pt.x - origin.x, y = pt.y - origin.y, z = pt.z - origin.z;
+			return sqrtf(x * x + y * y + z * z) - radius;
+		}
+	};
+
+	struct BoxX
+	{
+		Vector3 origin;
+		Vector3 lengths;
+
+		constexpr BoxX(Vector3 origin, Vector3 lengths) : origin(origin), lengths(lengths) {}
+
+		float operator()(Vector3 pt) const
+		{
+			float qx = fabsf(pt.x - origin.x) - lengths.x;
+			float qy = fabsf(pt.y - origin.y) - lengths.y;
+			float qz = fabsf(pt.z - origin.z) - lengths.z;
+
+			float ox = fmaxf(qx, 0.0f), oy = fmaxf(qy, 0.0f), oz = fmaxf(qz, 0.0f);
+			return sqrtf(ox * ox + oy * oy + oz * oz) + fminf(fmaxf(qx, fmaxf(qy, qz)), 0.0f);
+		}
+	};
+
+	struct TorusX
+	{
+		Vector3 origin;
+		Vector2 torusValues;
+
+		constexpr TorusX(Vector3 origin, Vector2 values) : origin(origin), torusValues(values) {}
+
+		float operator()(Vector3 pt) const
+		{
+			float x = pt.x - origin.x, y = pt.y - origin.y, z = pt.z - origin.z;
+			float qx = sqrtf(x * x + z * z) - torusValues.x;
+			return sqrtf(qx * qx + y * y) - torusValues.y;
+		}
+	};
+
+	template <typename A, typename B>
+	struct SmoothUnionX
+	{
+		A a;
+		B b;
+		float k;
+
+		constexpr SmoothUnionX(A a, B b, float k) : a(a), b(b), k(k) {}
+
+		float operator()(Vector3 pt) const
+		{
+			return sminX(a(pt), b(pt), k);
+		}
+	};
+
+	template <typename A, typename B>
+	struct UnionX
+	{
+		A a;
+		B b;
+
+		constexpr UnionX(A a, B b) : a(a), b(b) {}
+
+		float operator()(Vector3 pt) const
+		{
+			float da = a(pt), db = b(pt);
+			return (da < db) ? da : db;
+		}
+	};
+
+	template <typename A, typename B>
+	constexpr SmoothUnionX<A, B> smoothUnion(A a, B b, float k)
+	{
+		return SmoothUnionX<A, B>(a, b, k);
+	}
+
+	template <typename A, typename B>
+	constexpr UnionX<A, B> hardUnion(A a, B b)
+	{
+		return UnionX<A, B>(a, b);
+	}
+}
+
+#endif
@@ -0,0 +1,70 @@
+#include "shapebuffer.hpp"
+#include "rlgl.h"
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+
+static GpuShape packShape(int type, Vector3 origin, Vector3 size, Vector3 col)
+{
+	GpuShape s = {};
+	s.origin = origin;
+	s.type = type;
+	s.size = size;
+	s.col = col;
+	return s;
+}
+
+void ShapeBuffer::sync(const int types[], const Vector3 origins[], const Vector3 sizes[], const Vector3 cols[], int count)
+{
+	if (id == 0 || count > capacity)
+	{
+		unload();
+		capacity = max(64, max(count, capacity * 2));
+		uploaded.assign(capacity, GpuShape());
+		for (int i = 0; i < count; i++)
+		{
+			uploaded[i] = packShape(types[i], origins[i], sizes[i], cols[i]);
+		}
+
+		// the spare capacity is never read, only the live shapes go over
+		id = rlLoadShaderBuffer(capacity * sizeof(GpuShape), nullptr, RL_DYNAMIC_DRAW);
+		rlBindShaderBuffer(id, SHAPE_BUFFER_BINDING);
+		if (count > 0) upload(0, count);
+		return;
+	}
+
+	// runs of changed shapes, closed once the next change is MERGE_GAP away
+	int runStart = -1;
+	int runEnd = -1;
+
+	for (int i = 0; i < count; i++)
+	{
+		GpuShape s = packShape(types[i], origins[i], sizes[i], cols[i]);
+		if (memcmp(&s, &uploaded[i], sizeof(GpuShape)) == 0) continue;
+		uploaded[i] = s;
+
+		if (runStart >= 0 && i - runEnd >= MERGE_GAP)
+		{
+			upload(runStart, runEnd);
+			runStart = -1;
+		}
+		if (runStart < 0) runStart = i;
+		runEnd = i + 1;
+	}
+	if (runStart >= 0) upload(runStart, runEnd);
+}
+
+void ShapeBuffer::upload(int first, int last)
+{
+	int bytes = (last - first) * sizeof(GpuShape);
+	rlUpdateShaderBuffer(id, &uploaded[first], bytes, first * sizeof(GpuShape));
+	uploads++;
+	bytesUploaded += bytes;
+}
+
+void ShapeBuffer::unload()
+{
+	if (id != 0) rlUnloadShaderBuffer(id);
+	id = 0;
+}
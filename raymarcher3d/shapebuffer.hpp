@@ -0,0 +1,53 @@
+#ifndef SHAPEBUFFER_HPP
+#define SHAPEBUFFER_HPP
+
+#include "raylib.h"
+#include <vector>
+
+// Shape storage buffer for raymarcher3d.fs.
+//
+// The shader reads the shapes from a std430 storage buffer, so the scene
+// size is limited by GPU memory rather than the uniform array size. sync()
+// compares the scene against what the GPU already holds and uploads only
+// the runs of shapes that changed, merging runs less than MERGE_GAP shapes
+// apart into one call. The buffer doubles when the scene outgrows it, which
+// is the only time everything is re-uploaded. It never shrinks; the shader
+// loops to shapeCount in ShapeBlock.
+
+static const int SHAPE_BUFFER_BINDING = 0;		// storage buffer binding, StepStats and PixelCost are 1 and 2
+
+// one shape as the shader's ShapeData, 48 bytes in std430
+struct GpuShape
+{
+	Vector3 origin; int type;
+	Vector3 size; float pad0;
+	Vector3 col; float pad1;
+};
+
+static_assert(sizeof(GpuShape) == 48, "ShapeData is 48 bytes in std430");
+
+class ShapeBuffer
+{
+public:
+	static const int MERGE_GAP = 16;
+
+	unsigned int id = 0;
+	int capacity = 0;		// shapes the GPU buffer holds
+
+	// since resetStats()
+	int uploads = 0;
+	int bytesUploaded = 0;
+
+	// the scene as parallel arrays, like buildShapes and DirtyTracker take
+	// it; after InitWindow. Binds the buffer whenever it is reallocated
+	void sync(const int types[], const Vector3 origins[], const Vector3 sizes[], const Vector3 cols[], int count);
+	void unload();
+	void resetStats() { uploads = bytesUploaded = 0; }
+
+private:
+	std::vector<GpuShape> uploaded;		// what the GPU holds, first capacity shapes
+
+	void upload(int first, int last);	// [first, last) of uploaded
+};
+
+#endif
@@ -0,0 +1,198 @@
+#include "simd.hpp"
+#include "engine.hpp"
+#include <math.h>
+#include <string.h>
+
+#if SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// scalar lanes, the reference the wider kernels are checked against
+namespace simd_scalar
+{
+	struct V
+	{
+		typedef float T;
+		typedef bool M;
+		static const int W = 1;
+
+		static T load(const float* p) { return *p; }
+		static void store(float* p, T a) { *p = a; }
+		static T set1(float a) { return a; }
+
+		static T add(T a, T b) { return a + b; }
+		static T sub(T a, T b) { return a - b; }
+		static T mul(T a, T b) { return a * b; }
+		static T div(T a, T b) { return a / b; }
+		static T min(T a, T b) { return (a < b) ? a : b; }
+		static T max(T a, T b) { return (a > b) ? a : b; }
+		static T sqrt(T a) { return sqrtf(a); }
+		static T abs(T a) { return fabsf(a); }
+
+		static T round(T a) { return nearbyintf(a); }
+		static T pow2i(T n) { return ldexpf(1.0f, (int)n); }
+		static T exponent(T a) { int e; frexpf(a, &e); return (float)(e - 1); }
+		static T mantissa(T a) { int e; return 2.0f * frexpf(a, &e); }
+
+		static M lt(T a, T b) { return a < b; }
+		static M ge(T a, T b) { return a >= b; }
+		static M mand(M a, M b) { return a && b; }
+		static bool any(M m) { return m; }
+		static T select(M m, T a, T b) { return m ? a : b; }
+	};
+
+#include "simd_kernels.inl"
+}
+
+SimdLevel detectSimd()
+{
+#if SIMD_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	bool avx2 = false;
+	bool avx512 = false;
+	if (maxLeaf >= 7 && osxsave && avx)
+	{
+		unsigned long long xcr0 = _xgetbv(0);
+		__cpuidex(info, 7, 0);
+		avx2 = (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+		avx512 = (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	bool sse2 = __builtin_cpu_supports("sse2");
+	bool avx2 = __builtin_cpu_supports("avx2");
+	bool avx512 = __builtin_cpu_supports("avx512f");
+#endif
+
+	if (avx512) return SIMD_AVX512;
+	if (avx2) return SIMD_AVX2;
+	if (sse2) return SIMD_SSE;
+#endif
+	return SIMD_SCALAR;
+}
+
+const char* simdName(SimdLevel level)
+{
+	switch (level)
+	{
+		case SIMD_SSE: return "sse";
+		case SIMD_AVX2: return "avx2";
+		case SIMD_AVX512: return "avx512";
+		default: return "scalar";
+	}
+}
+
+bool parseSimdLevel(const char* name, SimdLevel& level)
+{
+	if (strcmp(name, "auto") == 0) level = detectSimd();
+	else if (strcmp(name, "scalar") == 0) level = SIMD_SCALAR;
+	else if (strcmp(name, "sse") == 0) level = SIMD_SSE;
+	else if (strcmp(name, "avx2") == 0) level = SIMD_AVX2;
+	else if (strcmp(name, "avx512") == 0) level = SIMD_AVX512;
+	else return false;
+	return true;
+}
+
+const SimdKernels& simdKernels(SimdLevel level)
+{
+	static SimdLevel best = detectSimd();
+	static SimdKernels table[4];
+	static bool filled = false;
+
+	if (!filled)
+	{
+		simd_scalar::fillKernels(table[0], SIMD_SCALAR);
+		table[1] = table[2] = table[3] = table[0];
+#if SIMD_X86
+		if (best >= SIMD_SSE) fillKernelsSSE(table[1]);
+		if (best >= SIMD_AVX2) fillKernelsAVX2(table[2]);
+		if (best >= SIMD_AVX512) fillKernelsAVX512(table[3]);
+#endif
+		filled = true;
+	}
+
+	if (level > best) level = best;
+
+	switch (level)
+	{
+		case SIMD_SSE: return table[1];
+		case SIMD_AVX2: return table[2];
+		case SIMD_AVX512: return table[3];
+		default: return table[0];
+	}
+}
+
+const SimdKernels& simdKernels()
+{
+	return simdKernels(detectSimd());
+}
+
+bool packetSupported(const Shape* s)
+{
+	switch (s->type)
+	{
+		case SHAPE_TYPE_SPHERE:
+		case SHAPE_TYPE_BOX:
+		case SHAPE_TYPE_TORUS:
+			return true;
+		case SHAPE_TYPE_MANDELBULB:
+			// the packet path only has the integer power expansion
+			return mandelbulbIntegerPower(((const Mandelbulb*)s)->power);
+		default:
+			return false;
+	}
+}
+
+int packShapes(Shape* shapes[], int count, PacketShape* out)
+{
+	int packed = 0;
+	for (int i = 0; i < count; i++)
+	{
+		Shape* s = shapes[i];
+		if (!packetSupported(s)) continue;
+
+		PacketShape p = { s->type, s->origin.x, s->origin.y, s->origin.z, 0.0f, 0.0f, 0.0f };
+
+		switch (s->type)
+		{
+			case SHAPE_TYPE_SPHERE:
+				p.sx = ((Sphere*)s)->radius;
+				break;
+			case SHAPE_TYPE_BOX:
+				p.sx = ((Box*)s)->lengths.x;
+				p.sy = ((Box*)s)->lengths.y;
+				p.sz = ((Box*)s)->lengths.z;
+				break;
+			case SHAPE_TYPE_TORUS:
+				p.sx = ((Torus*)s)->torusValues.x;
+				p.sy = ((Torus*)s)->torusValues.y;
+				break;
+			case SHAPE_TYPE_MANDELBULB:
+				p.sx = ((Mandelbulb*)s)->iterations;
+				p.sy = ((Mandelbulb*)s)->scale;
+				p.sz = ((Mandelbulb*)s)->power;
+				break;
+			default:
+				continue;
+		}
+
+		out[packed++] = p;
+	}
+	return packed;
+}
+
+RayLanes rayLanes(RayBuffer& rays)
+{
+	return { rays.ox, rays.oy, rays.oz, rays.dx, rays.dy, rays.dz, rays.t, rays.steps, rays.evals };
+}
@@ -0,0 +1,73 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+// Packet SDF kernels (SSE2 / AVX2 / AVX-512), picked at runtime.
+// Kept free of raylib/STL includes: the per-ISA translation units are built
+// for a wider target, and inline code pulled in there could be picked by the
+// linker over the baseline copy and run on CPUs without that ISA.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+class Shape;
+class RayBuffer;
+
+enum SimdLevel
+{
+	SIMD_SCALAR = 1,	// values are the packet width
+	SIMD_SSE = 4,
+	SIMD_AVX2 = 8,
+	SIMD_AVX512 = 16
+};
+
+// one primitive, flattened (type codes as SHAPE_TYPE_*)
+struct PacketShape
+{
+	int type;
+	float ox, oy, oz;	// origin
+	float sx, sy, sz;	// size values, same layout as shapeSizes
+};
+
+// raw lanes of a RayBuffer
+struct RayLanes
+{
+	float* ox; float* oy; float* oz;
+	float* dx; float* dy; float* dz;
+	float* t;
+	int* steps;
+	int* evals;
+};
+
+struct SimdKernels
+{
+	SimdLevel level;
+	int width;
+
+	// distance of one shape at n points
+	void (*sdf)(const PacketShape& shape, const float* px, const float* py, const float* pz, float* out, int n);
+	// SdfMinOfAll at n points
+	void (*sceneMin)(const PacketShape* shapes, int count, const float* px, const float* py, const float* pz, float* out, int n, float k);
+	// march lanes [first, first + n) together, same stopping rules as Cam3d::marchRay
+	void (*march)(RayLanes rays, int first, int n, const PacketShape* shapes, int count, float k, float hitThreshold, float clipEnd);
+};
+
+// Function declarations
+SimdLevel detectSimd();							// best level this CPU supports
+const char* simdName(SimdLevel);
+bool parseSimdLevel(const char*, SimdLevel&);	// "scalar", "sse", "avx2", "avx512", "auto"
+const SimdKernels& simdKernels(SimdLevel);		// clamped to what the CPU supports
+const SimdKernels& simdKernels();				// best available
+
+bool packetSupported(const Shape*);				// false for non-integer Mandelbulb powers and unknown types
+int packShapes(Shape*[], int, PacketShape*);		// unsupported shapes are skipped
+RayLanes rayLanes(RayBuffer&);
+
+// (used by simd.cpp, only defined when SIMD_X86)
+void fillKernelsSSE(SimdKernels&);
+void fillKernelsAVX2(SimdKernels&);
+void fillKernelsAVX512(SimdKernels&);
+
+#endif
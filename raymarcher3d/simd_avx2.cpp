@@ -0,0 +1,70 @@
+#include "simd.hpp"
+
+#if SIMD_X86
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx2")
+#endif
+
+namespace simd_avx2
+{
+	struct V
+	{
+		typedef __m256 T;
+		typedef __m256 M;
+		static const int W = 8;
+
+		static T load(const float* p) { return _mm256_load_ps(p); }
+		static void store(float* p, T a) { _mm256_store_ps(p, a); }
+		static T set1(float a) { return _mm256_set1_ps(a); }
+
+		static T add(T a, T b) { return _mm256_add_ps(a, b); }
+		static T sub(T a, T b) { return _mm256_sub_ps(a, b); }
+		static T mul(T a, T b) { return _mm256_mul_ps(a, b); }
+		static T div(T a, T b) { return _mm256_div_ps(a, b); }
+		static T min(T a, T b) { return _mm256_min_ps(a, b); }
+		static T max(T a, T b) { return _mm256_max_ps(a, b); }
+		static T sqrt(T a) { return _mm256_sqrt_ps(a); }
+		static T abs(T a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+		static T round(T a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static T pow2i(T n)
+		{
+			__m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127));
+			return _mm256_castsi256_ps(_mm256_slli_epi32(e, 23));
+		}
+		// floor(log2(a)) and a / 2^that, for positive normal a
+		static T exponent(T a)
+		{
+			__m256i e = _mm256_srli_epi32(_mm256_castps_si256(a), 23);
+			return _mm256_cvtepi32_ps(_mm256_sub_epi32(e, _mm256_set1_epi32(127)));
+		}
+		static T mantissa(T a)
+		{
+			__m256i m = _mm256_and_si256(_mm256_castps_si256(a), _mm256_set1_epi32(0x007fffff));
+			return _mm256_castsi256_ps(_mm256_or_si256(m, _mm256_set1_epi32(0x3f800000)));
+		}
+
+		static M lt(T a, T b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static M ge(T a, T b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static M mand(M a, M b) { return _mm256_and_ps(a, b); }
+		static bool any(M m) { return _mm256_movemask_ps(m) != 0; }
+		static T select(M m, T a, T b) { return _mm256_blendv_ps(b, a, m); }
+	};
+
+#include "simd_kernels.inl"
+}
+
+void fillKernelsAVX2(SimdKernels& kernels)
+{
+	simd_avx2::fillKernels(kernels, SIMD_AVX2);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+#include "simd.hpp"
+
+#if SIMD_X86
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx512f")
+#endif
+
+namespace simd_avx512
+{
+	struct V
+	{
+		typedef __m512 T;
+		typedef __mmask16 M;
+		static const int W = 16;
+
+		static T load(const float* p) { return _mm512_load_ps(p); }
+		static void store(float* p, T a) { _mm512_store_ps(p, a); }
+		static T set1(float a) { return _mm512_set1_ps(a); }
+
+		static T add(T a, T b) { return _mm512_add_ps(a, b); }
+		static T sub(T a, T b) { return _mm512_sub_ps(a, b); }
+		static T mul(T a, T b) { return _mm512_mul_ps(a, b); }
+		static T div(T a, T b) { return _mm512_div_ps(a, b); }
+		static T min(T a, T b) { return _mm512_min_ps(a, b); }
+		static T max(T a, T b) { return _mm512_max_ps(a, b); }
+		static T sqrt(T a) { return _mm512_sqrt_ps(a); }
+		static T abs(T a) { return _mm512_abs_ps(a); }
+
+		static T round(T a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static T pow2i(T n)
+		{
+			__m512i e = _mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127));
+			return _mm512_castsi512_ps(_mm512_slli_epi32(e, 23));
+		}
+		static T exponent(T a) { return _mm512_getexp_ps(a); }
+		static T mantissa(T a) { return _mm512_getmant_ps(a, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero); }
+
+		static M lt(T a, T b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+		static M ge(T a, T b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+		static M mand(M a, M b) { return (M)(a & b); }
+		static bool any(M m) { return m != 0; }
+		static T select(M m, T a, T b) { return _mm512_mask_blend_ps(m, b, a); }
+	};
+
+#include "simd_kernels.inl"
+}
+
+void fillKernelsAVX512(SimdKernels& kernels)
+{
+	simd_avx512::fillKernels(kernels, SIMD_AVX512);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+#endif
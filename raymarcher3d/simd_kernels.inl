@@ -0,0 +1,307 @@
+// Packet kernel bodies shared by every ISA.
+// Included inside a namespace that defines the lane traits V:
+//   V::T (float lanes), V::M (lane mask), V::W (width) and the ops used below.
+// Do not include headers here.
+
+typedef V::T T;
+typedef V::M M;
+
+static inline T length3(T x, T y, T z)
+{
+	return V::sqrt(V::add(V::add(V::mul(x, x), V::mul(y, y)), V::mul(z, z)));
+}
+
+static inline T sdSphere(const PacketShape& s, T px, T py, T pz)
+{
+	T x = V::sub(px, V::set1(s.ox));
+	T y = V::sub(py, V::set1(s.oy));
+	T z = V::sub(pz, V::set1(s.oz));
+	return V::sub(length3(x, y, z), V::set1(s.sx));
+}
+
+static inline T sdBox(const PacketShape& s, T px, T py, T pz)
+{
+	T zero = V::set1(0.0f);
+	T qx = V::sub(V::abs(V::sub(px, V::set1(s.ox))), V::set1(s.sx));
+	T qy = V::sub(V::abs(V::sub(py, V::set1(s.oy))), V::set1(s.sy));
+	T qz = V::sub(V::abs(V::sub(pz, V::set1(s.oz))), V::set1(s.sz));
+
+	T outside = length3(V::max(qx, zero), V::max(qy, zero), V::max(qz, zero));
+	T inside = V::min(V::max(qx, V::max(qy, qz)), zero);
+	return V::add(outside, inside);
+}
+
+static inline T sdTorus(const PacketShape& s, T px, T py, T pz)
+{
+	T x = V::sub(px, V::set1(s.ox));
+	T y = V::sub(py, V::set1(s.oy));
+	T z = V::sub(pz, V::set1(s.oz));
+
+	T qx = V::sub(V::sqrt(V::add(V::mul(x, x), V::mul(z, z))), V::set1(s.sx));
+	return V::sub(V::sqrt(V::add(V::mul(qx, qx), V::mul(y, y))), V::set1(s.sy));
+}
+
+// 2^y for y <= 0 (cephes exp2f polynomial, ~2e-7 relative error)
+static inline T exp2neg(T y)
+{
+	y = V::max(y, V::set1(-30.0f));
+	T n = V::round(y);
+	T f = V::sub(y, n);
+
+	T p = V::set1(1.535336188319500e-4f);
+	p = V::add(V::mul(p, f), V::set1(1.339887440266574e-3f));
+	p = V::add(V::mul(p, f), V::set1(9.618437357674640e-3f));
+	p = V::add(V::mul(p, f), V::set1(5.550332471162809e-2f));
+	p = V::add(V::mul(p, f), V::set1(2.402264791363012e-1f));
+	p = V::add(V::mul(p, f), V::set1(6.931472028550421e-1f));
+	p = V::add(V::mul(p, f), V::set1(1.0f));
+
+	return V::mul(p, V::pow2i(n));
+}
+
+// log2(1 + x) for x in [0, 1] (atanh series)
+static inline T log2onePlus(T x)
+{
+	T s = V::div(x, V::add(x, V::set1(2.0f)));
+	T s2 = V::mul(s, s);
+
+	T p = V::set1(1.0f / 9.0f);
+	p = V::add(V::mul(p, s2), V::set1(1.0f / 7.0f));
+	p = V::add(V::mul(p, s2), V::set1(1.0f / 5.0f));
+	p = V::add(V::mul(p, s2), V::set1(1.0f / 3.0f));
+	p = V::add(V::mul(p, s2), V::set1(1.0f));
+
+	return V::mul(V::mul(s, p), V::set1(2.0f * 1.4426950408889634f));
+}
+
+// log2(a) for positive a
+static inline T log2Packet(T a)
+{
+	return V::add(V::exponent(a), log2onePlus(V::sub(V::mantissa(a), V::set1(1.0f))));
+}
+
+// a^n, n >= 0
+static inline T powInt(T a, int n)
+{
+	T r = V::set1(1.0f);
+	while (n > 0)
+	{
+		if (n & 1) r = V::mul(r, a);
+		a = V::mul(a, a);
+		n >>= 1;
+	}
+	return r;
+}
+
+// (c + i s)^n, n >= 0
+static inline void complexPow(T& c, T& s, int n)
+{
+	T rc = V::set1(1.0f), rs = V::set1(0.0f);
+	while (n > 0)
+	{
+		if (n & 1)
+		{
+			T t = V::sub(V::mul(rc, c), V::mul(rs, s));
+			rs = V::add(V::mul(rc, s), V::mul(rs, c));
+			rc = t;
+		}
+		T t = V::sub(V::mul(c, c), V::mul(s, s));
+		s = V::mul(V::add(c, c), s);
+		c = t;
+		n >>= 1;
+	}
+	c = rc;
+	s = rs;
+}
+
+// mandelbulbDE() for an integer power (packShapes skips the rest).
+// sx = iterations, sy = scale, sz = power. Lanes that escape are frozen;
+// the loop ends once every lane has
+static inline T sdMandelbulb(const PacketShape& s, T px, T py, T pz)
+{
+	T one = V::set1(1.0f);
+	T tiny = V::set1(1e-20f);
+	T invScale = V::set1(1.0f / s.sy);
+	T radius = V::set1(s.sy * 2.0f);
+	T power = V::set1(s.sz);
+	int n = (int)s.sz;
+
+	T cx = V::mul(V::sub(px, V::set1(s.ox)), invScale);
+	T cy = V::mul(V::sub(py, V::set1(s.oy)), invScale);
+	T cz = V::mul(V::sub(pz, V::set1(s.oz)), invScale);
+
+	T zx = cx, zy = cy, zz = cz;
+	T dr = one;
+	T r = V::set1(0.0f);
+	M active = V::ge(one, V::set1(0.0f));
+
+	for (int i = 0; i < s.sx; i++)
+	{
+		T rNow = length3(zx, zy, zz);
+		r = V::select(active, rNow, r);
+		active = V::mand(active, V::ge(radius, rNow));
+		if (!V::any(active)) break;
+
+		T rho = V::sqrt(V::add(V::mul(zx, zx), V::mul(zz, zz)));
+		T invR = V::div(one, V::max(rNow, tiny));
+		T invRho = V::div(one, V::max(rho, tiny));
+
+		T ct = V::mul(zy, invR), st = V::mul(rho, invR);
+		T cp = V::mul(zx, invRho), sp = V::mul(zz, invRho);
+		complexPow(ct, st, n);
+		complexPow(cp, sp, n);
+
+		T rPow = powInt(rNow, n - 1);
+		T zr = V::mul(rPow, rNow);
+
+		zx = V::select(active, V::add(V::mul(V::mul(st, cp), zr), cx), zx);
+		zy = V::select(active, V::add(V::mul(ct, zr), cy), zy);
+		zz = V::select(active, V::add(V::mul(V::mul(sp, st), zr), cz), zz);
+		dr = V::select(active, V::add(V::mul(V::mul(rPow, power), dr), one), dr);
+	}
+
+	// 0.5 * ln(r) * r / dr * scale
+	T ln = V::mul(log2Packet(r), V::set1(0.6931471805599453f * 0.5f * s.sy));
+	return V::div(V::mul(ln, r), dr);
+}
+
+static inline T shapeSdf(const PacketShape& s, T px, T py, T pz)
+{
+	switch (s.type)
+	{
+		case 0: return sdSphere(s, px, py, pz);
+		case 1: return sdBox(s, px, py, pz);
+		case 2: return sdTorus(s, px, py, pz);
+		case 3: return sdMandelbulb(s, px, py, pz);
+	}
+	return V::set1(1e6f);
+}
+
+// same as smin() in engine.cpp, rearranged as min - k*log2(1 + 2^(-|a-b|/k))
+// so it cannot overflow far from the surface
+static inline T sminPacket(T a, T b, float k)
+{
+	if (k <= 0.05f) return V::min(a, b);
+
+	T kk = V::set1(k);
+	T diff = V::div(V::abs(V::sub(a, b)), kk);
+	T blend = log2onePlus(exp2neg(V::sub(V::set1(0.0f), diff)));
+	return V::sub(V::min(a, b), V::mul(kk, blend));
+}
+
+static inline T sceneSdf(const PacketShape* shapes, int count, T px, T py, T pz, float k)
+{
+	if (count <= 0) return V::set1(1e30f);	// empty scene, nothing to hit
+
+	T d = shapeSdf(shapes[0], px, py, pz);
+	for (int i = 1; i < count; i++)
+	{
+		d = sminPacket(d, shapeSdf(shapes[i], px, py, pz), k);
+	}
+	return d;
+}
+
+// copy up to W lanes into a full packet, padding the rest with pad
+static inline T loadPartial(const float* p, int valid, float pad)
+{
+	alignas(64) float tmp[V::W];
+	for (int i = 0; i < V::W; i++) tmp[i] = (i < valid) ? p[i] : pad;
+	return V::load(tmp);
+}
+
+static inline void storePartial(float* p, int valid, T v)
+{
+	alignas(64) float tmp[V::W];
+	V::store(tmp, v);
+	for (int i = 0; i < valid; i++) p[i] = tmp[i];
+}
+
+static void sdfKernel(const PacketShape& shape, const float* px, const float* py, const float* pz, float* out, int n)
+{
+	for (int i = 0; i < n; i += V::W)
+	{
+		int valid = (n - i < V::W) ? n - i : V::W;
+		T x = loadPartial(px + i, valid, 0.0f);
+		T y = loadPartial(py + i, valid, 0.0f);
+		T z = loadPartial(pz + i, valid, 0.0f);
+		storePartial(out + i, valid, shapeSdf(shape, x, y, z));
+	}
+}
+
+static void sceneMinKernel(const PacketShape* shapes, int count, const float* px, const float* py, const float* pz, float* out, int n, float k)
+{
+	for (int i = 0; i < n; i += V::W)
+	{
+		int valid = (n - i < V::W) ? n - i : V::W;
+		T x = loadPartial(px + i, valid, 0.0f);
+		T y = loadPartial(py + i, valid, 0.0f);
+		T z = loadPartial(pz + i, valid, 0.0f);
+		storePartial(out + i, valid, sceneSdf(shapes, count, x, y, z, k));
+	}
+}
+
+static void marchKernel(RayLanes r, int first, int n, const PacketShape* shapes, int count, float k, float hitThreshold, float clipEnd)
+{
+	T hit = V::set1(hitThreshold);
+	T clip = V::set1(clipEnd);
+	T zero = V::set1(0.0f);
+	T one = V::set1(1.0f);
+
+	// an empty scene: every ray misses without evaluating anything
+	if (count <= 0)
+	{
+		for (int i = first; i < first + n; i++) r.t[i] = clipEnd * 2.0f;
+		return;
+	}
+
+	for (int i = first; i < first + n; i += V::W)
+	{
+		int valid = (first + n - i < V::W) ? first + n - i : V::W;
+
+		T ox = loadPartial(r.ox + i, valid, 0.0f);
+		T oy = loadPartial(r.oy + i, valid, 0.0f);
+		T oz = loadPartial(r.oz + i, valid, 0.0f);
+		T dx = loadPartial(r.dx + i, valid, 0.0f);
+		T dy = loadPartial(r.dy + i, valid, 0.0f);
+		T dz = loadPartial(r.dz + i, valid, 0.0f);
+		T t = loadPartial(r.t + i, valid, clipEnd);	// padding lanes start finished
+
+		alignas(64) float stepTmp[V::W];
+		for (int l = 0; l < V::W; l++) stepTmp[l] = (l < valid) ? (float)r.steps[i + l] : 0.0f;
+		T steps = V::load(stepTmp);
+		for (int l = 0; l < V::W; l++) stepTmp[l] = (l < valid) ? (float)r.evals[i + l] : 0.0f;
+		T evals = V::load(stepTmp);
+
+		M active = V::lt(t, clip);
+		while (V::any(active))
+		{
+			T px = V::add(ox, V::mul(dx, t));
+			T py = V::add(oy, V::mul(dy, t));
+			T pz = V::add(oz, V::mul(dz, t));
+			T d = sceneSdf(shapes, count, px, py, pz, k);
+			evals = V::select(active, V::add(evals, one), evals);
+
+			// a negative distance ends the lane without stepping
+			M advance = V::mand(active, V::ge(d, zero));
+			t = V::select(advance, V::add(t, d), t);
+			steps = V::select(advance, V::add(steps, one), steps);
+
+			active = V::mand(advance, V::mand(V::lt(t, clip), V::ge(d, hit)));
+		}
+
+		storePartial(r.t + i, valid, t);
+		V::store(stepTmp, steps);
+		for (int l = 0; l < valid; l++) r.steps[i + l] = (int)stepTmp[l];
+		V::store(stepTmp, evals);
+		for (int l = 0; l < valid; l++) r.evals[i + l] = (int)stepTmp[l];
+	}
+}
+
+static void fillKernels(SimdKernels& kernels, SimdLevel level)
+{
+	kernels.level = level;
+	kernels.width = V::W;
+	kernels.sdf = sdfKernel;
+	kernels.sceneMin = sceneMinKernel;
+	kernels.march = marchKernel;
+}
@@ -0,0 +1,70 @@
+#include "simd.hpp"
+
+#if SIMD_X86
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("sse2")
+#endif
+
+namespace simd_sse
+{
+	struct V
+	{
+		typedef __m128 T;
+		typedef __m128 M;
+		static const int W = 4;
+
+		static T load(const float* p) { return _mm_load_ps(p); }
+		static void store(float* p, T a) { _mm_store_ps(p, a); }
+		static T set1(float a) { return _mm_set1_ps(a); }
+
+		static T add(T a, T b) { return _mm_add_ps(a, b); }
+		static T sub(T a, T b) { return _mm_sub_ps(a, b); }
+		static T mul(T a, T b) { return _mm_mul_ps(a, b); }
+		static T div(T a, T b) { return _mm_div_ps(a, b); }
+		static T min(T a, T b) { return _mm_min_ps(a, b); }
+		static T max(T a, T b) { return _mm_max_ps(a, b); }
+		static T sqrt(T a) { return _mm_sqrt_ps(a); }
+		static T abs(T a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+		static T round(T a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+		static T pow2i(T n)
+		{
+			__m128i e = _mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127));
+			return _mm_castsi128_ps(_mm_slli_epi32(e, 23));
+		}
+		// floor(log2(a)) and a / 2^that, for positive normal a
+		static T exponent(T a)
+		{
+			__m128i e = _mm_srli_epi32(_mm_castps_si128(a), 23);
+			return _mm_cvtepi32_ps(_mm_sub_epi32(e, _mm_set1_epi32(127)));
+		}
+		static T mantissa(T a)
+		{
+			__m128i m = _mm_and_si128(_mm_castps_si128(a), _mm_set1_epi32(0x007fffff));
+			return _mm_castsi128_ps(_mm_or_si128(m, _mm_set1_epi32(0x3f800000)));
+		}
+
+		static M lt(T a, T b) { return _mm_cmplt_ps(a, b); }
+		static M ge(T a, T b) { return _mm_cmpge_ps(a, b); }
+		static M mand(M a, M b) { return _mm_and_ps(a, b); }
+		static bool any(M m) { return _mm_movemask_ps(m) != 0; }
+		static T select(M m, T a, T b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+	};
+
+#include "simd_kernels.inl"
+}
+
+void fillKernelsSSE(SimdKernels& kernels)
+{
+	simd_sse::fillKernels(kernels, SIMD_SSE);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+#endif
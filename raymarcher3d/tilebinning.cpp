@@ -0,0 +1,99 @@
+#include "tilebinning.hpp"
+#include "glproc.hpp"
+#include "raylib.h"
+#include "rlgl.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+// rlComputeShaderDispatch doesn't order its writes before later reads
+typedef void (GL_CALL *MemoryBarrierFn)(unsigned int);
+static MemoryBarrierFn memoryBarrier = nullptr;
+
+static const unsigned int SHADER_STORAGE_BARRIER_BIT = 0x2000;	// GL_SHADER_STORAGE_BARRIER_BIT
+
+bool TileBinner::load(const char* path)
+{
+	unload();
+
+	char* code = LoadFileText(path);
+	if (code == nullptr) return false;
+	unsigned int shader = rlCompileShader(code, RL_COMPUTE_SHADER);
+	UnloadFileText(code);
+	if (shader == 0) return false;
+
+	program = rlLoadComputeShaderProgram(shader);
+	if (program == 0) return false;
+	passLoc = rlGetLocationUniform(program, "binPass");
+
+	memoryBarrier = (MemoryBarrierFn)glfwGetProcAddress("glMemoryBarrier");
+	if (memoryBarrier == nullptr)
+	{
+		cerr << "BINNING: glMemoryBarrier unavailable, tile binning off" << endl;
+		unload();
+		return false;
+	}
+	return true;
+}
+
+void TileBinner::unload()
+{
+	if (program != 0) rlUnloadShaderProgram(program);
+	if (countBuffer != 0) rlUnloadShaderBuffer(countBuffer);
+	if (listBuffer != 0) rlUnloadShaderBuffer(listBuffer);
+	if (rectBuffer != 0) rlUnloadShaderBuffer(rectBuffer);
+	program = countBuffer = listBuffer = rectBuffer = 0;
+	rectCapacity = tilesX = tilesY = 0;
+}
+
+void TileBinner::resize(int width, int height, int count)
+{
+	int x = (width + TILE_SIZE - 1) / TILE_SIZE;
+	int y = (height + TILE_SIZE - 1) / TILE_SIZE;
+	if (countBuffer == 0 || x != tilesX || y != tilesY)
+	{
+		if (countBuffer != 0) rlUnloadShaderBuffer(countBuffer);
+		if (listBuffer != 0) rlUnloadShaderBuffer(listBuffer);
+		tilesX = x;
+		tilesY = y;
+
+		// every tile count is rewritten by each dispatch, no need to clear
+		countBuffer = rlLoadShaderBuffer(x * y * sizeof(unsigned int), nullptr, RL_DYNAMIC_COPY);
+		listBuffer = rlLoadShaderBuffer(x * y * TILE_MAX_SHAPES * sizeof(unsigned int), nullptr, RL_DYNAMIC_COPY);
+		rlBindShaderBuffer(countBuffer, TILE_COUNT_BINDING);
+		rlBindShaderBuffer(listBuffer, TILE_SHAPE_BINDING);
+	}
+
+	// grows like the shape buffer
+	if (rectBuffer == 0 || count > rectCapacity)
+	{
+		if (rectBuffer != 0) rlUnloadShaderBuffer(rectBuffer);
+		rectCapacity = max(64, max(count, rectCapacity * 2));
+		rectBuffer = rlLoadShaderBuffer(rectCapacity * 4 * sizeof(int), nullptr, RL_DYNAMIC_COPY);
+		rlBindShaderBuffer(rectBuffer, SHAPE_TILE_BINDING);
+	}
+}
+
+void TileBinner::dispatch(int width, int height, int count)
+{
+	if (program == 0) return;
+	resize(width, height, count);
+
+	int tiles = tilesX * tilesY;
+	int pass = 0;
+
+	rlEnableShader(program);
+	if (count > 0)
+	{
+		rlSetUniform(passLoc, &pass, RL_SHADER_UNIFORM_INT, 1);
+		rlComputeShaderDispatch((count + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+		memoryBarrier(SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	pass = 1;
+	rlSetUniform(passLoc, &pass, RL_SHADER_UNIFORM_INT, 1);
+	rlComputeShaderDispatch((tiles + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+	memoryBarrier(SHADER_STORAGE_BARRIER_BIT);
+	rlDisableShader();
+}
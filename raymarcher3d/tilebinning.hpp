@@ -0,0 +1,49 @@
+#ifndef TILEBINNING_HPP
+#define TILEBINNING_HPP
+
+// Compute-shader tile binning for raymarcher3d.fs.
+//
+// In a scene of many small shapes each screen tile only sees a few of them,
+// yet the looping shader evaluates every shape at every march step.
+// dispatch() runs tilebin.comp over the shape buffer: one pass projects
+// each shape's bounds, grown by the smooth-min reach, to a rectangle of
+// TILE_SIZE pixel tiles, a second lists for each tile the shapes covering
+// it. With FEATURE_TILE_BINNING the primary ray march loops over its tile's
+// list only. Shadows, AO and normals step off the ray and still see every
+// shape, as does a tile covered by more than TILE_MAX_SHAPES.
+//
+// Needs GL 4.3 compute shaders, which Mesa's llvmpipe has as well.
+
+static const int TILE_COUNT_BINDING = 3;	// storage buffer bindings, after the shapes, StepStats and PixelCost
+static const int TILE_SHAPE_BINDING = 4;
+static const int SHAPE_TILE_BINDING = 5;	// per shape tile rectangles, compute pass only
+
+class TileBinner
+{
+public:
+	static const int TILE_SIZE = 16;			// as tilebin.comp and raymarcher3d.fs
+	static const int TILE_MAX_SHAPES = 128;
+	static const int GROUP_SIZE = 64;			// tilebin.comp local_size_x
+
+	unsigned int program = 0;
+	int tilesX = 0;
+	int tilesY = 0;
+
+	bool load(const char* path);	// after InitWindow; false if the compute shader fails
+	void unload();
+
+	// bin the first count shapes in the shape buffer for a width x height
+	// target; CameraBlock and ShapeBlock must already be up to date
+	void dispatch(int width, int height, int count);
+
+private:
+	unsigned int countBuffer = 0;
+	unsigned int listBuffer = 0;
+	unsigned int rectBuffer = 0;
+	int rectCapacity = 0;		// shapes rectBuffer holds
+	int passLoc = -1;
+
+	void resize(int width, int height, int count);
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "tilescheduler.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start)
+{
+	return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+bool TileScheduler::popLocal(int thread, int& tile)
+{
+	Queue& q = queues[thread];
+	lock_guard<mutex> guard(q.lock);
+	if (q.tiles.empty()) return false;
+
+	tile = q.tiles.back();
+	q.tiles.pop_back();
+	return true;
+}
+
+// take from the front of the other deques, starting with the next thread up
+bool TileScheduler::steal(int thread, int& tile)
+{
+	int count = (int)queues.size();
+	for (int i = 1; i < count; i++)
+	{
+		Queue& q = queues[(thread + i) % count];
+		lock_guard<mutex> guard(q.lock);
+		if (q.tiles.empty()) continue;
+
+		tile = q.tiles.front();
+		q.tiles.pop_front();
+		return true;
+	}
+	return false;
+}
+
+void TileScheduler::run(int width, int height, int tileSize, int threads, const function<void(const TileRect&, int)>& render)
+{
+	if (threads < 1) threads = 1;
+	if (tileSize < 1) tileSize = 32;
+
+	int tilesX = (width + tileSize - 1) / tileSize;
+	int tilesY = (height + tileSize - 1) / tileSize;
+	int tileCount = tilesX * tilesY;
+
+	// deques hold a mutex, so rebuild rather than resize
+	vector<Queue> fresh(threads);
+	queues.swap(fresh);
+	stats.assign(threads, TileThreadStats());
+
+	// contiguous runs in reverse so each owner pops its run front to back
+	for (int t = 0; t < threads; t++)
+	{
+		int first = (int)((long long)tileCount * t / threads);
+		int last = (int)((long long)tileCount * (t + 1) / threads);
+		for (int tile = last - 1; tile >= first; tile--)
+		{
+			queues[t].tiles.push_back(tile);
+		}
+	}
+
+	if (trace && trace->capturing)
+	{
+		for (int i = 1; i < threads; i++) trace->nameThread(i, "Tile worker " + to_string(i));
+	}
+
+	atomic<int> remaining{ tileCount };
+	Clock::time_point start = Clock::now();
+
+	auto worker = [&](int thread)
+	{
+		TileThreadStats& s = stats[thread];
+
+		while (remaining.load() > 0)
+		{
+			int tile;
+			bool stolen = false;
+			if (!popLocal(thread, tile))
+			{
+				if (!steal(thread, tile))
+				{
+					// everything is taken, the last tiles are still in flight
+					this_thread::yield();
+					continue;
+				}
+				stolen = true;
+			}
+
+			int x0 = (tile % tilesX) * tileSize;
+			int y0 = (tile / tilesX) * tileSize;
+			TileRect rect = { x0, y0, min(x0 + tileSize, width), min(y0 + tileSize, height) };
+
+			Clock::time_point tileStart = Clock::now();
+			render(rect, thread);
+			s.busyMs += msSince(tileStart);
+			if (trace) trace->record("Tile", "cpu", thread, tileStart, Clock::now());
+			s.tiles++;
+			s.stolen += stolen;
+
+			remaining--;
+		}
+	};
+
+	vector<thread> pool;
+	for (int i = 1; i < threads; i++)
+	{
+		pool.emplace_back(worker, i);
+	}
+	worker(0);
+	for (int i = 0; i < pool.size(); i++)
+	{
+		pool[i].join();
+	}
+
+	// idle is measured against the whole run, so waiting for stragglers counts too
+	wallMs = msSince(start);
+	for (int i = 0; i < threads; i++)
+	{
+		stats[i].idleMs = max(0.0, wallMs - stats[i].busyMs);
+	}
+}
+
+double TileScheduler::busyMs() const
+{
+	double total = 0.0;
+	for (int i = 0; i < stats.size(); i++) total += stats[i].busyMs;
+	return total;
+}
+
+double TileScheduler::imbalance() const
+{
+	if (stats.empty()) return 1.0;
+
+	double slowest = 0.0;
+	for (int i = 0; i < stats.size(); i++) slowest = max(slowest, stats[i].busyMs);
+
+	double mean = busyMs() / stats.size();
+	return (mean > 0.0) ? slowest / mean : 1.0;
+}
+
+void TileScheduler::printStats() const
+{
+	for (int i = 0; i < stats.size(); i++)
+	{
+		const TileThreadStats& s = stats[i];
+		printf("  thread %2d: busy %8.2f ms, idle %8.2f ms, %4d tiles (%d stolen)\n", i, s.busyMs, s.idleMs, s.tiles, s.stolen);
+	}
+	printf("  imbalance %.3f (slowest / mean busy)\n", imbalance());
+}
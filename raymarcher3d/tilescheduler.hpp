@@ -0,0 +1,61 @@
+#ifndef TILESCHEDULER_HPP
+#define TILESCHEDULER_HPP
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class TraceRecorder;
+
+// Work-stealing tile scheduler for the CPU render paths.
+//
+// The frame is cut into tiles which are dealt out to one deque per thread in
+// contiguous runs, so neighbouring tiles (and their rays) stay on one core.
+// A thread pops its own tiles from the back; once empty it steals from the
+// front of the other deques. Cheap background tiles finish quickly and their
+// threads take over the tail of whoever got the expensive ones.
+
+struct TileRect
+{
+	int x0, y0;		// inclusive
+	int x1, y1;		// exclusive
+};
+
+// per thread timings of the last run()
+struct TileThreadStats
+{
+	double busyMs = 0.0;	// inside the tile callback
+	double idleMs = 0.0;	// looking for work or waiting for the others to finish
+	int tiles = 0;			// tiles rendered
+	int stolen = 0;			// of which taken from another thread
+};
+
+class TileScheduler
+{
+public:
+	std::vector<TileThreadStats> stats;
+	double wallMs = 0.0;
+	TraceRecorder* trace = nullptr;		// tiles recorded per thread while it captures
+
+	// calls render(tile, threadIndex) once per tile; the calling thread is thread 0
+	void run(int width, int height, int tileSize, int threads, const std::function<void(const TileRect&, int)>& render);
+
+	double busyMs() const;			// summed over threads
+	double imbalance() const;		// slowest thread busy time / mean busy time, 1 = perfect
+	void printStats() const;
+
+private:
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<int> tiles;
+	};
+
+	std::vector<Queue> queues;
+
+	bool popLocal(int thread, int& tile);
+	bool steal(int thread, int& tile);
+};
+
+#endif
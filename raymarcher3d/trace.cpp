@@ -0,0 +1,80 @@
+#include "trace.hpp"
+#include <cstdio>
+
+using namespace std;
+
+TraceRecorder::TraceRecorder()
+{
+	epoch = Clock::now();
+}
+
+void TraceRecorder::start(int capacity)
+{
+	ring.assign(capacity > 0 ? capacity : 1, TraceEvent());
+	next = 0;
+	capturing = true;
+}
+
+void TraceRecorder::record(const char* name, const char* category, int tid, double startUs, double durationUs)
+{
+	if (!capturing) return;
+
+	long long slot = next.fetch_add(1);
+	ring[slot % (long long)ring.size()] = { name, category, startUs, durationUs, tid };
+}
+
+void TraceRecorder::record(const char* name, const char* category, int tid, Clock::time_point begin, Clock::time_point end)
+{
+	if (!capturing) return;
+	record(name, category, tid, toUs(begin), chrono::duration<double, micro>(end - begin).count());
+}
+
+void TraceRecorder::nameThread(int tid, const string& name)
+{
+	lock_guard<mutex> guard(namesLock);
+	threadNames[tid] = name;
+}
+
+double TraceRecorder::toUs(Clock::time_point t) const
+{
+	return chrono::duration<double, micro>(t - epoch).count();
+}
+
+int TraceRecorder::size() const
+{
+	long long n = next.load();
+	return (int)(n < (long long)ring.size() ? n : (long long)ring.size());
+}
+
+bool TraceRecorder::write(const string& path) const
+{
+	FILE* f = fopen(path.c_str(), "w");
+	if (!f)
+	{
+		return false;
+	}
+
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"raymarcher3d\"}}");
+	{
+		lock_guard<mutex> guard(namesLock);
+		for (map<int, string>::const_iterator it = threadNames.begin(); it != threadNames.end(); ++it)
+		{
+			fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				it->first, it->second.c_str());
+		}
+	}
+
+	// oldest first once the ring has wrapped
+	long long n = next.load();
+	long long count = size();
+	for (long long i = n - count; i < n; i++)
+	{
+		const TraceEvent& e = ring[i % (long long)ring.size()];
+		fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+			e.name, e.category, e.startUs, e.durationUs, e.tid);
+	}
+
+	fprintf(f, "\n]}\n");
+	return fclose(f) == 0;
+}
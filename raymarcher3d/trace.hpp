@@ -0,0 +1,61 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Capture of timed events for chrome://tracing and Perfetto.
+//
+// Events go into a fixed ring, so a long capture keeps the most recent
+// ones. Any thread may record: a slot is claimed with one atomic add and
+// nothing is locked. write() saves the ring as trace-event JSON ("X"
+// complete events plus thread names) and should be called once capture has
+// stopped.
+
+// track ids, tile workers use their scheduler thread index
+constexpr int TRACE_TID_MAIN = 0;
+constexpr int TRACE_TID_GPU = 1000;
+
+struct TraceEvent
+{
+	const char* name;		// must outlive the recorder (string literals)
+	const char* category;
+	double startUs;
+	double durationUs;
+	int tid;
+};
+
+class TraceRecorder
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	std::atomic<bool> capturing{ false };
+
+	TraceRecorder();
+
+	void start(int capacity = 1 << 16);		// clears the ring
+	void stop() { capturing = false; }
+
+	void record(const char* name, const char* category, int tid, double startUs, double durationUs);
+	void record(const char* name, const char* category, int tid, Clock::time_point begin, Clock::time_point end);
+	void nameThread(int tid, const std::string& name);
+
+	double toUs(Clock::time_point) const;	// on the trace timeline
+	int size() const;						// events held
+	bool write(const std::string& path) const;
+
+private:
+	Clock::time_point epoch;
+	std::vector<TraceEvent> ring;
+	std::atomic<long long> next{ 0 };
+
+	mutable std::mutex namesLock;
+	std::map<int, std::string> threadNames;
+};
+
+#endif
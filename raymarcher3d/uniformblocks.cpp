@@ -0,0 +1,59 @@
+#include "uniformblocks.hpp"
+#include "glproc.hpp"
+#include "rlgl.h"
+#include <iostream>
+#include <string.h>
+
+using namespace std;
+
+// rlgl's shader buffers are plain buffer objects, only binding one to a
+// uniform block index needs GL directly
+typedef void (GL_CALL *BindBufferBaseFn)(unsigned int, unsigned int, unsigned int);
+
+static const unsigned int UNIFORM_BUFFER = 0x8A11;		// GL_UNIFORM_BUFFER
+
+void UniformBlock::load(int binding, int size)
+{
+	unload();
+	this->binding = binding;
+	this->size = size;
+
+	id = rlLoadShaderBuffer(size, nullptr, RL_DYNAMIC_DRAW);
+	shadow.assign(size, 0);
+	valid = false;
+
+	BindBufferBaseFn bindBufferBase = (BindBufferBaseFn)glfwGetProcAddress("glBindBufferBase");
+	if (bindBufferBase) bindBufferBase(UNIFORM_BUFFER, binding, id);
+	else cerr << "UNIFORMS: glBindBufferBase unavailable, block " << binding << " unbound" << endl;
+}
+
+void UniformBlock::unload()
+{
+	if (id != 0) rlUnloadShaderBuffer(id);
+	id = 0;
+	shadow.clear();
+	valid = false;
+}
+
+void UniformBlock::update(const void* data)
+{
+	if (id == 0) return;
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	int first = 0;
+	int last = size;
+
+	if (valid)
+	{
+		while (first < size && bytes[first] == shadow[first]) first++;
+		if (first == size) return;
+		while (bytes[last - 1] == shadow[last - 1]) last--;
+	}
+
+	memcpy(shadow.data() + first, bytes + first, last - first);
+	rlUpdateShaderBuffer(id, bytes + first, last - first, first);
+	valid = true;
+
+	uploads++;
+	bytesUploaded += last - first;
+}
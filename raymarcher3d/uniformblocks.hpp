@@ -0,0 +1,79 @@
+#ifndef UNIFORMBLOCKS_HPP
+#define UNIFORMBLOCKS_HPP
+
+#include "raylib.h"
+#include <vector>
+
+// std140 uniform blocks for raymarcher3d.fs.
+//
+// The shader's inputs are grouped by how often they change: the camera and
+// view settings, the lighting, and the shapes. Each block keeps a copy of
+// what was last uploaded; update() compares against it and sends only the
+// byte range that changed, so an idle frame uploads nothing. The structs
+// below mirror the GLSL blocks member for member, padded to std140 (a vec3
+// takes 16 bytes unless a scalar fills its last 4).
+
+enum UniformBinding
+{
+	BINDING_CAMERA = 3,		// uniform buffer bindings, separate from the storage buffer ones
+	BINDING_LIGHTING = 4,
+	BINDING_SHAPES = 5
+};
+
+// camera, march settings and debug views
+struct CameraUniforms
+{
+	Vector3 camOrigin; float camFOV;
+	Vector3 camDir; float clipEnd;
+	Vector3 prevCamOrigin; float hitThreshold;
+	Vector3 prevCamDir; float relaxation;
+	Vector2 iResolution; int countSteps; int adaptiveThreshold;
+	int depthReuse; float depthReuseFraction; int heatmapMode; float heatmapMax;
+	float heatmapBlend; float pad[3];
+};
+
+struct LightingUniforms
+{
+	Vector3 lightPos; float sb;
+	Vector3 lightColor; float shininess;
+	Vector3 bgColor; float glowIntensity;
+	Vector3 glowCol; float shadowSmoothness;
+	int aoSteps; float aoStepSize; float aoBias; float specularStrength;
+};
+
+// the shapes themselves are in the storage buffer (shapebuffer.hpp)
+struct ShapeUniforms
+{
+	int shapeCount; float k; float pad[2];
+};
+
+static_assert(sizeof(CameraUniforms) == 112, "CameraBlock is 112 bytes in std140");
+static_assert(sizeof(LightingUniforms) == 80, "LightingBlock is 80 bytes in std140");
+static_assert(sizeof(ShapeUniforms) == 16, "ShapeBlock is 16 bytes in std140");
+
+class UniformBlock
+{
+public:
+	unsigned int id = 0;
+	int binding = 0;
+	int size = 0;
+
+	// since resetStats()
+	int uploads = 0;
+	int bytesUploaded = 0;
+
+	// after InitWindow, needs the GL context; binds the buffer to binding,
+	// which stays bound since nothing else in the app uses uniform buffers
+	void load(int binding, int size);
+	void unload();
+
+	void update(const void* data);		// uploads the changed range, if any
+	void invalidate() { valid = false; }	// next update() uploads the whole block
+	void resetStats() { uploads = bytesUploaded = 0; }
+
+private:
+	std::vector<unsigned char> shadow;	// contents of the GPU buffer
+	bool valid = false;
+};
+
+#endif